@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This is a reference producer for Filtlong's shared-memory ring buffer input (--shm_input). It creates a ring file
+(e.g. in /dev/shm) and streams the records of a FASTQ/FASTA file into it, for testing or as a model for a producer
+built into other tools. The protocol is described in src/shm_ring.h.
+
+Usage:
+  shm_ring_producer.py /dev/shm/filtlong_ring reads.fastq.gz &
+  filtlong --shm_input --min_length 1000 /dev/shm/filtlong_ring > filtered.fastq
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+import argparse
+import gzip
+import mmap
+import struct
+import time
+
+HEADER_SIZE = 64
+MAGIC = b'FLRING1\0'
+SKIP_MARKER = 0xFFFFFFFF
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream reads into a Filtlong shared-memory ring buffer')
+    parser.add_argument('ring', help='ring buffer file to create (e.g. /dev/shm/filtlong_ring)')
+    parser.add_argument('reads', help='FASTQ or FASTA file of reads (can be gzipped)')
+    parser.add_argument('--capacity', type=int, default=64 * 1024 * 1024,
+                        help='size of the ring data area in bytes (default: 64 MiB)')
+    args = parser.parse_args()
+
+    capacity = (args.capacity + 7) // 8 * 8
+    with open(args.ring, 'w+b') as ring_file:
+        ring_file.truncate(HEADER_SIZE + capacity)
+        ring = mmap.mmap(ring_file.fileno(), HEADER_SIZE + capacity)
+    struct.pack_into('<QQQQ', ring, 8, capacity, 0, 0, 0)
+    ring[0:8] = MAGIC  # written last, so a consumer never sees a half-made header
+
+    # The ring is closed even if something goes wrong, so the consumer doesn't wait forever.
+    write_pos = 0
+    try:
+        for name, comment, seq, qual in load_reads(args.reads):
+            write_pos = write_record(ring, capacity, write_pos, name, comment, seq, qual)
+    finally:
+        struct.pack_into('<Q', ring, 32, 1)
+        ring.close()
+
+
+def write_record(ring, capacity, write_pos, name, comment, seq, qual):
+    record = struct.pack('<IIII', len(name), len(comment), len(seq), len(qual)) + name + comment + seq + qual
+    record += b'\0' * (-len(record) % 8)
+    if len(record) > capacity:
+        raise SystemExit('Error: record ' + name.decode() + ' is larger than the ring buffer')
+
+    # Records never wrap around the end of the data area, so a skip marker fills the end if needed. The marker is
+    # published on its own, so the consumer can pass it (freeing that space) before the record is written.
+    offset = write_pos % capacity
+    if capacity - offset < len(record):
+        wait_for_space(ring, capacity, write_pos, capacity - offset)
+        struct.pack_into('<I', ring, HEADER_SIZE + offset, SKIP_MARKER)
+        write_pos += capacity - offset
+        struct.pack_into('<Q', ring, 16, write_pos)
+        offset = 0
+    wait_for_space(ring, capacity, write_pos, len(record))
+
+    ring[HEADER_SIZE + offset:HEADER_SIZE + offset + len(record)] = record
+    write_pos += len(record)
+    struct.pack_into('<Q', ring, 16, write_pos)  # publish the record
+    return write_pos
+
+
+def wait_for_space(ring, capacity, write_pos, needed):
+    while True:
+        read_pos = struct.unpack_from('<Q', ring, 24)[0]
+        if capacity - (write_pos - read_pos) >= needed:
+            return
+        time.sleep(0.0002)
+
+
+def load_reads(filename):
+    with open(filename, 'rb') as f:
+        gzipped = f.read(2) == b'\x1f\x8b'
+    open_func = gzip.open if gzipped else open
+    with open_func(filename, 'rb') as reads:
+        lines = (line.rstrip(b'\r\n') for line in reads)
+        header, seq_lines = None, []
+        for line in lines:
+            if not line:
+                continue
+            if line.startswith(b'@') and header is None:  # FASTQ: four lines per read
+                seq = next(lines)
+                next(lines)
+                qual = next(lines)
+                yield split_header(line[1:]) + (seq, qual)
+            elif line.startswith(b'>'):  # FASTA: sequence can span multiple lines
+                if header is not None:
+                    yield split_header(header) + (b''.join(seq_lines), b'')
+                header, seq_lines = line[1:], []
+            else:
+                seq_lines.append(line)
+        if header is not None:
+            yield split_header(header) + (b''.join(seq_lines), b'')
+
+
+def split_header(header):
+    parts = header.split(None, 1)
+    return parts[0], (parts[1] if len(parts) > 1 else b'')
+
+
+if __name__ == '__main__':
+    main()
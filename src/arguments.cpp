@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fstream>
+#include <algorithm>
 
 #include "args.h"
 
@@ -94,18 +95,66 @@ Arguments::Arguments(int argc, char **argv) {
     d_arg min_window_q_arg(thresholds_group, "float",
                            "minimum window quality threshold",
                            {"min_window_q"});
+    i_arg max_depth_arg(thresholds_group, "int",
+                        "with an assembly reference, skip reads whose reference regions are all already covered "
+                        "to this depth by better reads (up to 65535, uses about 2 bytes of memory per assembly base)",
+                        {"max_depth"});
+    s_arg selection_curve_arg(thresholds_group, "file",
+                              "write the bases, mean quality and N50 kept at every score threshold to this file",
+                              {"selection_curve"});
 
     args::Group references_group(parser, "NLexternal references "   // The NL at the start results in a newline
             "(if provided, read quality will be determined using these instead of from the Phred scores):");
-    s_arg assembly_arg(references_group, "file",
-                       "reference assembly in FASTA format",
-                        {'a', "assembly"});
+    args::ValueFlagList<std::string> assembly_arg(references_group, "file",
+                                                  "reference assembly in FASTA format (can be used more than once)",
+                                                  {'a', "assembly"});
     s_arg illumina_1_arg(references_group, "file",
                          "reference Illumina reads in FASTQ format",
                          {'1', "illumina_1"});
     s_arg illumina_2_arg(references_group, "file",
                          "reference Illumina reads in FASTQ format",
                          {'2', "illumina_2"});
+    s_arg load_kmer_index_arg(references_group, "file",
+                              "Illumina 16-mer index from --save_kmer_index (-1/-2 reads are added to it)",
+                              {"load_kmer_index"});
+    s_arg save_kmer_index_arg(references_group, "file",
+                              "save the Illumina 16-mers and their counts to this file (a few bytes per "
+                              "distinct 16-mer), so more reads can be added later",
+                              {"save_kmer_index"});
+    d_arg reference_check_arg(references_group, "float",
+                              "warn if less than this fraction of 16-mers in the first 100 input reads are in the "
+                              "reference (default: 0.02, 0 to disable)",
+                              {"reference_check"}, 0.02);
+    f_arg reference_check_abort_arg(references_group, "reference_check_abort",
+                                    "quit with an error (instead of warning) when the reference check fails",
+                                    {"reference_check_abort"});
+    s_arg reference_report_arg(references_group, "file",
+                               "with more than one reference, write each read's k-mer hit fraction per reference "
+                               "to this file",
+                               {"reference_report"});
+    s_arg score_reference_arg(references_group, "file",
+                              "with more than one reference, score reads using only this one (an -a assembly, "
+                              "or illumina_reads for the Illumina reference)",
+                              {"score_reference"});
+    i_arg illumina_min_q_arg(references_group, "int",
+                             "skip Illumina 16-mers containing a base with a Phred score below this",
+                             {"illumina_min_q"}, 0);
+    i_arg illumina_trim_q_arg(references_group, "int",
+                              "trim Illumina read tails with Phred scores below this before hashing",
+                              {"illumina_trim_q"}, 0);
+    i_arg minimizer_window_arg(references_group, "int",
+                               "only index reference 16-mers which are minimizers in windows of this many 16-mers "
+                               "(approximate, uses less memory)",
+                               {"minimizer_window"});
+
+    args::Group exclusion_group(parser, "NLexclusion (e.g. host or contaminant screening):");
+    s_arg exclude_assembly_arg(exclusion_group, "file",
+                               "fail reads which share too many 16-mers with this assembly in FASTA format",
+                               {"exclude_assembly"});
+    d_arg exclude_fraction_arg(exclusion_group, "float",
+                               "fail reads with more than this fraction of their 16-mers in the exclusion assembly "
+                               "(default: 0.5)",
+                               {"exclude_fraction"}, 0.5);
 
     args::Group score_weights_group(parser, "NLscore weights "    // The NL at the start results in a newline
                                             "(control the relative contribution of each score to the final read score):");
@@ -129,10 +178,67 @@ Arguments::Arguments(int argc, char **argv) {
                     "split reads at this many (or more) consecutive non-k-mer-matching bases",
                     {"split"});
 
+    args::Group output_group(parser, "NLoutput format:");    // The NL at the start results in a newline
+    f_arg fasta_output_arg(output_group, "fasta_output",
+                           "output reads in FASTA format (drop qualities)",
+                           {"fasta_output"});
+    s_arg qual_bins_arg(output_group, "list",
+                        "bin output qualities: comma-delimited Phred values, each qscore is lowered to the nearest "
+                        "(e.g. 2,10,20,30)",
+                        {"qual_bins"});
+    s_arg shard_output_arg(output_group, "prefix",
+                           "write reads to gzipped shard files (prefix_1.fastq.gz, etc.) instead of stdout",
+                           {"shard_output"});
+    i_arg shards_arg(output_group, "int",
+                     "number of shard files, reads are assigned round-robin (default: 4)",
+                     {"shards"}, 4);
+    f_arg shard_by_bases_arg(output_group, "shard_by_bases",
+                             "assign each read to the shard with the fewest bases (instead of round-robin)",
+                             {"shard_by_bases"});
+    i_arg shard_max_bases_arg(output_group, "int",
+                              "instead of a fixed number of shards, start a new shard when one reaches this many "
+                              "bases",
+                              {"shard_max_bases"});
+
+    args::Group read_ids_group(parser, "NLread IDs:");    // The NL at the start results in a newline
+    s_arg write_ids_arg(read_ids_group, "file",
+                        "write the names (and trimmed/split ranges) of the kept reads to this file",
+                        {"write_ids"});
+    s_arg apply_ids_arg(read_ids_group, "file",
+                        "output input reads listed in this file (made with --write_ids) without scoring",
+                        {"apply_ids"});
+
+    args::Group coverage_group(parser, "NLcoverage cache (for re-scoring without a reference):");
+    s_arg save_coverage_arg(coverage_group, "file",
+                            "save each read's reference k-mer coverage to this file",
+                            {"save_coverage"});
+    s_arg load_coverage_arg(coverage_group, "file",
+                            "score reads using k-mer coverage saved with --save_coverage (instead of a reference)",
+                            {"load_coverage"});
+
     args::Group other_group(parser, "NLother:");    // The NL at the start results in a newline
     i_arg window_size_arg(other_group, "int",
                           "size of sliding window used when measuring window quality (default: 250)",
                           {"window_size"}, 250);
+    f_arg header_qscore_arg(other_group, "header_qscore",
+                            "take mean quality from basecaller qscores in read headers (qs: or "
+                            "mean_qscore_template=), requires --window_q_weight 0",
+                            {"header_qscore"});
+    i_arg approx_length_arg(other_group, "int",
+                            "estimate qualities from a sample of bases for reads at least this long",
+                            {"approx_length"});
+    i_arg approx_stride_arg(other_group, "int",
+                            "when estimating qualities, sample every this many bases (default: 10)",
+                            {"approx_stride"}, 10);
+    f_arg use_index_arg(other_group, "use_index",
+                        "use a samtools faidx/fqidx index of input_reads (.fai, plus .gzi if BGZF-compressed) to "
+                        "skip reads which fail on length without decompressing them (skipped reads aren't used to "
+                        "normalise mean quality scores)",
+                        {"use_index"});
+    f_arg shm_input_arg(other_group, "shm_input",
+                        "input_reads is a shared-memory ring buffer (see scripts/shm_ring_producer.py): reads are "
+                        "filtered as they arrive, using per-read thresholds only",
+                        {"shm_input"});
     f_arg verbose_arg(other_group, "verbose",
                       "verbose output to stderr with info for each read",
                       {"verbose"});
@@ -188,13 +294,44 @@ Arguments::Arguments(int argc, char **argv) {
     keep_percent = args::get(keep_percent_arg);
 
     assembly_set = bool(assembly_arg);
-    assembly = args::get(assembly_arg);
+    assemblies = args::get(assembly_arg);
 
     if (bool(illumina_1_arg))
         illumina_reads.push_back(args::get(illumina_1_arg));
     if (bool(illumina_2_arg))
         illumina_reads.push_back(args::get(illumina_2_arg));
 
+    load_kmer_index_set = bool(load_kmer_index_arg);
+    load_kmer_index = args::get(load_kmer_index_arg);
+
+    save_kmer_index_set = bool(save_kmer_index_arg);
+    save_kmer_index = args::get(save_kmer_index_arg);
+
+    reference_check = args::get(reference_check_arg);
+    reference_check_abort = args::get(reference_check_abort_arg);
+
+    reference_report_set = bool(reference_report_arg);
+    reference_report = args::get(reference_report_arg);
+
+    score_reference_set = bool(score_reference_arg);
+    score_reference = args::get(score_reference_arg);
+
+    exclude_assembly_set = bool(exclude_assembly_arg);
+    exclude_assembly = args::get(exclude_assembly_arg);
+    exclude_fraction = args::get(exclude_fraction_arg);
+
+    illumina_min_q = args::get(illumina_min_q_arg);
+    illumina_trim_q = args::get(illumina_trim_q_arg);
+
+    minimizer_window_set = bool(minimizer_window_arg);
+    minimizer_window = args::get(minimizer_window_arg);
+
+    max_depth_set = bool(max_depth_arg);
+    max_depth = int(std::min(args::get(max_depth_arg), 65536LL));
+
+    selection_curve_set = bool(selection_curve_arg);
+    selection_curve = args::get(selection_curve_arg);
+
     min_length_set = bool(min_length_arg);
     min_length = args::get(min_length_arg);
 
@@ -213,28 +350,182 @@ Arguments::Arguments(int argc, char **argv) {
     split_set = bool(split_arg);
     split = args::get(split_arg);
 
+    fasta_output = args::get(fasta_output_arg);
+    if (bool(qual_bins_arg)) {
+        std::istringstream bins(args::get(qual_bins_arg));
+        std::string bin;
+        while (std::getline(bins, bin, ',')) {
+            if (bin.empty() || bin.find_first_not_of("0123456789") != std::string::npos || bin.size() > 2) {
+                std::cerr << "Error: --qual_bins must be a comma-delimited list of Phred values from 0 to 93\n";
+                parsing_result = BAD;
+                return;
+            }
+            qual_bins.push_back(std::stoi(bin));
+        }
+        for (size_t i = 1; i < qual_bins.size(); ++i) {
+            if (qual_bins[i] <= qual_bins[i-1]) {
+                std::cerr << "Error: --qual_bins values must be in increasing order\n";
+                parsing_result = BAD;
+                return;
+            }
+        }
+        if (qual_bins.empty() || qual_bins.back() > 93) {
+            std::cerr << "Error: --qual_bins must be a comma-delimited list of Phred values from 0 to 93\n";
+            parsing_result = BAD;
+            return;
+        }
+    }
+
+    shard_output_set = bool(shard_output_arg);
+    shard_output = args::get(shard_output_arg);
+    shards = args::get(shards_arg);
+    shard_by_bases = args::get(shard_by_bases_arg);
+    shard_max_bases_set = bool(shard_max_bases_arg);
+    shard_max_bases = args::get(shard_max_bases_arg);
+    if ((bool(shards_arg) || shard_by_bases || shard_max_bases_set) && !shard_output_set) {
+        std::cerr << "Error: --shards, --shard_by_bases and --shard_max_bases require --shard_output\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (shard_max_bases_set && (bool(shards_arg) || shard_by_bases)) {
+        std::cerr << "Error: --shard_max_bases cannot be used with --shards or --shard_by_bases\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (shards <= 0 || (shard_max_bases_set && shard_max_bases <= 0)) {
+        std::cerr << "Error: the values for --shards and --shard_max_bases must be positive integers\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    write_ids_set = bool(write_ids_arg);
+    write_ids = args::get(write_ids_arg);
+
+    apply_ids_set = bool(apply_ids_arg);
+    apply_ids = args::get(apply_ids_arg);
+
+    save_coverage_set = bool(save_coverage_arg);
+    save_coverage = args::get(save_coverage_arg);
+
+    load_coverage_set = bool(load_coverage_arg);
+    load_coverage = args::get(load_coverage_arg);
+
     window_size = args::get(window_size_arg);
+    header_qscore = args::get(header_qscore_arg);
+
+    approx_length_set = bool(approx_length_arg);
+    approx_length = args::get(approx_length_arg);
+    approx_stride = args::get(approx_stride_arg);
+    use_index = args::get(use_index_arg);
+    shm_input = args::get(shm_input_arg);
     verbose = args::get(verbose_arg);
 
-    bool some_reference = (illumina_reads.size() > 0 || assembly_set);
-    if (trim && !some_reference) {
+    // A coverage cache from an earlier run stands in for the reference when trimming/splitting.
+    bool illumina_reference = (illumina_reads.size() > 0 || load_kmer_index_set);
+    bool some_reference = (illumina_reference || assembly_set);
+    if (load_coverage_set && some_reference) {
+        std::cerr << "Error: --load_coverage cannot be used with an assembly or read reference" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (load_coverage_set && (header_qscore || approx_length_set || exclude_assembly_set)) {
+        std::cerr << "Error: --load_coverage cannot be used with --header_qscore, --approx_length or "
+                     "--exclude_assembly" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (save_coverage_set && !some_reference) {
+        std::cerr << "Error: assembly or read reference is required to use --save_coverage" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (trim && !some_reference && !load_coverage_set) {
         std::cerr << "Error: assembly or read reference is required to use --trim" << "\n";
         parsing_result = BAD;
         return;
     }
-    if (split_set && !some_reference) {
+    if (split_set && !some_reference && !load_coverage_set) {
         std::cerr << "Error: assembly or read reference is required to use --split" << "\n";
         parsing_result = BAD;
         return;
     }
+    if (minimizer_window_set && !some_reference) {
+        std::cerr << "Error: assembly or read reference is required to use --minimizer_window" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (max_depth_set && !assembly_set) {
+        std::cerr << "Error: an assembly reference is required to use --max_depth" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (save_kmer_index_set && !illumina_reference) {
+        std::cerr << "Error: Illumina reads or --load_kmer_index are required to use --save_kmer_index" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Each reference needs its own bit in the k-mer source bitmasks, which limits how many there can be.
+    int reference_count = int(assemblies.size()) + (illumina_reference ? 1 : 0);
+    if (reference_count > 8) {
+        std::cerr << "Error: at most 8 references (assemblies plus Illumina reads) can be used" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (reference_report_set && reference_count < 2) {
+        std::cerr << "Error: --reference_report requires more than one reference" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (score_reference_set && reference_count < 2) {
+        std::cerr << "Error: --score_reference requires more than one reference" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (score_reference_set &&
+            std::find(assemblies.begin(), assemblies.end(), score_reference) == assemblies.end() &&
+            !(score_reference == "illumina_reads" && illumina_reference)) {
+        std::cerr << "Error: --score_reference must be one of the -a assemblies or illumina_reads" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Header qscores only describe the read's mean quality, so they can't be used with a reference or when window
+    // quality matters.
+    if (header_qscore && some_reference) {
+        std::cerr << "Error: --header_qscore cannot be used with an assembly or read reference" << "\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (header_qscore && (window_q_weight != 0.0 || min_window_q_set)) {
+        std::cerr << "Error: --header_qscore requires --window_q_weight 0 and cannot be used with --min_window_q"
+                  << "\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Approximate qualities are estimated from Phred scores, so they don't apply to reference-based scoring.
+    if (approx_length_set && some_reference) {
+        std::cerr << "Error: --approx_length cannot be used with an assembly or read reference" << "\n";
+        parsing_result = BAD;
+        return;
+    }
 
     // Check to make sure files exist.
     std::vector<std::string> files;
     files.push_back(input_reads);
     for (auto f : illumina_reads)
         files.push_back(f);
-    if (assembly_set)
-        files.push_back(assembly);
+    for (auto f : assemblies)
+        files.push_back(f);
+    if (exclude_assembly_set)
+        files.push_back(exclude_assembly);
+    if (apply_ids_set)
+        files.push_back(apply_ids);
+    if (load_coverage_set)
+        files.push_back(load_coverage);
+    if (load_kmer_index_set)
+        files.push_back(load_kmer_index);
     for (auto f : files) {
         if (!does_file_exist(f)) {
             std::cerr << "Error: cannot find file: " << f << "\n";
@@ -243,11 +534,44 @@ Arguments::Arguments(int argc, char **argv) {
         }
     }
 
+    // A ring buffer is read once, as the reads arrive, so anything that needs the whole read set can't be used.
+    if (shm_input && (target_bases_set || keep_percent_set || max_depth_set || selection_curve_set ||
+                      save_coverage_set || load_coverage_set || write_ids_set || apply_ids_set ||
+                      shard_output_set || reference_report_set || verbose)) {
+        std::cerr << "Error: --shm_input only supports per-read thresholds (--min_length, --min_mean_q, "
+                     "--min_window_q, --exclude_assembly, --trim and --split)\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // The index is used to skip reads, so it can't be used with anything that needs every input read.
+    if (use_index && (shm_input || apply_ids_set || save_coverage_set || load_coverage_set)) {
+        std::cerr << "Error: --use_index cannot be used with --shm_input, --apply_ids, --save_coverage or "
+                     "--load_coverage\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // When applying a read ID list, no scoring takes place, so none of the thresholds matter.
+    if (apply_ids_set) {
+        if (write_ids_set) {
+            std::cerr << "Error: --apply_ids and --write_ids cannot be used together\n";
+            parsing_result = BAD;
+        }
+        else if (shard_output_set) {
+            std::cerr << "Error: --apply_ids and --shard_output cannot be used together\n";
+            parsing_result = BAD;
+        }
+        return;
+    }
+
     // If nothing is set, then Filtlong won't do anything. Give an error message and quit.
     if (!trim && !split_set && !target_bases_set && !keep_percent_set &&
-            !min_length_set && !min_mean_q_set && !min_window_q_set) {
+            !min_length_set && !min_mean_q_set && !min_window_q_set && !exclude_assembly_set &&
+            !selection_curve_set && !max_depth_set) {
         std::cerr << "Error: no thresholds set, you must use one of the following options:\n";
-        std::cerr << "target_bases, keep_percent, min_length, min_mean_q, min_window_q, trim, split\n";
+        std::cerr << "target_bases, keep_percent, min_length, min_mean_q, min_window_q, trim, split, "
+                     "exclude_assembly, selection_curve, max_depth\n";
         parsing_result = BAD;
         return;
     }
@@ -299,6 +623,68 @@ Arguments::Arguments(int argc, char **argv) {
         return;
     }
 
+    // exclude_fraction must be between 0 and 1.
+    if (exclude_fraction < 0.0 || exclude_fraction >= 1.0) {
+        std::cerr << "Error: the value for --exclude_fraction must be at least 0 and less than 1\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Illumina quality thresholds only make sense with Illumina reads, and can't be negative.
+    if ((illumina_min_q != 0 || illumina_trim_q != 0) && illumina_reads.size() == 0 && !load_kmer_index_set) {
+        std::cerr << "Error: Illumina reads are required to use --illumina_min_q or --illumina_trim_q\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (illumina_min_q < 0 || illumina_trim_q < 0) {
+        std::cerr << "Error: Illumina quality thresholds cannot be negative\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // max_depth must be positive. Region depths are counted in 16 bits, so it also can't be more than 65535.
+    if (max_depth_set && max_depth <= 0) {
+        std::cerr << "Error: the value for --max_depth must be a positive integer\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (max_depth_set && max_depth > 65535) {
+        std::cerr << "Error: the value for --max_depth cannot be more than 65535\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // reference_check is a fraction of 16-mers.
+    if (reference_check < 0.0 || reference_check > 1.0) {
+        std::cerr << "Error: the value for --reference_check must be between 0 and 1\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (reference_check_abort && !some_reference) {
+        std::cerr << "Error: assembly or read reference is required to use --reference_check_abort\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Non-positive minimizer_window doesn't make sense.
+    if (minimizer_window_set && minimizer_window <= 0) {
+        std::cerr << "Error: the value for --minimizer_window must be a positive integer\n";
+        parsing_result = BAD;
+        return;
+    }
+
+    // Non-positive approx_length and approx_stride don't make sense.
+    if (approx_length_set && approx_length <= 0) {
+        std::cerr << "Error: the value for --approx_length must be a positive integer\n";
+        parsing_result = BAD;
+        return;
+    }
+    if (approx_stride <= 0) {
+        std::cerr << "Error: the value for --approx_stride must be a positive integer\n";
+        parsing_result = BAD;
+        return;
+    }
+
     // Non-positive window_size doesn't make sense.
     if (window_size <= 0) {
         std::cerr << "Error: the value for --window_size must be a positive integer\n";
@@ -39,6 +39,12 @@ public:
     bool keep_percent_set;
     double keep_percent;
 
+    bool max_depth_set;
+    int max_depth;
+
+    bool selection_curve_set;
+    std::string selection_curve;
+
     bool min_length_set;
     int min_length;
 
@@ -49,9 +55,34 @@ public:
     double min_window_q;
 
     bool assembly_set;
-    std::string assembly;
+    std::vector<std::string> assemblies;
     std::vector<std::string> illumina_reads;
 
+    bool load_kmer_index_set;
+    std::string load_kmer_index;
+
+    bool save_kmer_index_set;
+    std::string save_kmer_index;
+
+    double reference_check;
+    bool reference_check_abort;
+
+    bool reference_report_set;
+    std::string reference_report;
+
+    bool score_reference_set;
+    std::string score_reference;
+
+    bool exclude_assembly_set;
+    std::string exclude_assembly;
+    double exclude_fraction;
+
+    int illumina_min_q;
+    int illumina_trim_q;
+
+    bool minimizer_window_set;
+    int minimizer_window;
+
     double length_weight;
     double mean_q_weight;
     double window_q_weight;
@@ -61,7 +92,37 @@ public:
     bool split_set;
     int split;
 
+    bool fasta_output;
+    std::vector<int> qual_bins;
+
+    bool shard_output_set;
+    std::string shard_output;
+    int shards;
+    bool shard_by_bases;
+    bool shard_max_bases_set;
+    long long shard_max_bases;
+
+    bool write_ids_set;
+    std::string write_ids;
+
+    bool apply_ids_set;
+    std::string apply_ids;
+
+    bool save_coverage_set;
+    std::string save_coverage;
+
+    bool load_coverage_set;
+    std::string load_coverage;
+
     int window_size;
+    bool header_qscore;
+
+    bool approx_length_set;
+    int approx_length;
+    int approx_stride;
+
+    bool use_index;
+    bool shm_input;
     bool verbose;
 
 
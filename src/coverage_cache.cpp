@@ -0,0 +1,65 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "coverage_cache.h"
+
+#include <sstream>
+
+
+void write_coverage(std::ostream & out, Read * read) {
+    out << read->m_name << "\t" << read->m_length << "\t";
+    if (read->m_covered_ranges.empty())
+        out << "*";
+    for (size_t i = 0; i < read->m_covered_ranges.size(); ++i) {
+        if (i > 0)
+            out << ",";
+        out << read->m_covered_ranges[i].first << "-" << read->m_covered_ranges[i].second;
+    }
+    out << "\n";
+}
+
+
+// Reads the next line of a coverage cache, filling in the read name and its per-base coverage (1 for covered bases, 0
+// for others). Returns 1 on success, 0 at the end of the file and -1 if the line couldn't be parsed.
+int read_coverage(std::istream & in, std::string & name, std::vector<double> & coverage) {
+    std::string line;
+    do {
+        if (!std::getline(in, line))
+            return 0;
+    } while (line.empty());
+
+    std::istringstream fields(line);
+    long long length;
+    std::string ranges;
+    if (!(fields >> name >> length >> ranges) || length < 0)
+        return -1;
+    coverage.assign(size_t(length), 0.0);
+    if (ranges == "*")
+        return 1;
+
+    std::istringstream range_list(ranges);
+    std::string range;
+    while (std::getline(range_list, range, ',')) {
+        long long start, end;
+        char dash;
+        std::istringstream range_stream(range);
+        if (!(range_stream >> start >> dash >> end) || dash != '-' || start < 0 || end < start || end > length)
+            return -1;
+        for (long long i = start; i < end; ++i)
+            coverage[i] = 1.0;
+    }
+    return 1;
+}
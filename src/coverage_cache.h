@@ -0,0 +1,36 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef COVERAGE_CACHE_H
+#define COVERAGE_CACHE_H
+
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "read.h"
+
+
+// A coverage cache stores each read's reference k-mer coverage so later runs can re-score the reads (e.g. with
+// different --trim/--split/--window_size settings) without the reference or the read sequences. It's a text file with
+// one line per read: the read name, its length and a comma-delimited list of covered 0-based ranges (start-end), or *
+// if no bases were covered.
+
+void write_coverage(std::ostream & out, Read * read);
+int read_coverage(std::istream & in, std::string & name, std::vector<double> & coverage);
+
+
+#endif // COVERAGE_CACHE_H
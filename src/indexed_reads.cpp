@@ -0,0 +1,250 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "indexed_reads.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "misc.h"
+
+
+// When the next read is less than this far ahead in the current BGZF stream, it's quicker to decompress up to it than
+// to reopen the stream at its block.
+#define INDEX_SKIP_LIMIT 1048576
+
+
+IndexedReads::IndexedReads() {
+    m_record_count = 0;
+    m_total_bases = 0;
+    m_selected_count = 0;
+    m_selected_bases = 0;
+    m_next = 0;
+    m_bgzf = false;
+    m_fd = -1;
+    m_stream_start = 0;
+}
+
+
+IndexedReads::~IndexedReads() {
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+
+bool IndexedReads::load(std::string filename) {
+    m_filename = filename;
+    std::cerr << "Loading read index\n";
+    std::cerr << "  " << filename << ".fai\n";
+
+    // BGZF files are gzipped, so they start with the gzip magic number and need the .gzi block index too.
+    unsigned char magic[2] = {0, 0};
+    std::ifstream input(filename, std::ios::binary);
+    input.read((char *)magic, 2);
+    m_bgzf = (magic[0] == 0x1f && magic[1] == 0x8b);
+    if (!load_fai(filename + ".fai"))
+        return false;
+    if (m_bgzf) {
+        if (!load_gzi(filename + ".gzi"))
+            return false;
+        m_fd = open(filename.c_str(), O_RDONLY);
+        if (m_fd < 0) {
+            std::cerr << "Error: could not read " << filename << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Each .fai line is: name, length, offset of the first base, bases per line, bytes per line and (for FASTQ) offset of
+// the first quality. A record's header starts where the previous record's last sequence (or quality) line ends.
+bool IndexedReads::load_fai(std::string fai_filename) {
+    std::ifstream fai(fai_filename);
+    if (!fai.good()) {
+        std::cerr << "Error: could not read " << fai_filename << " (make it with samtools faidx or fqidx)\n";
+        return false;
+    }
+    std::string line;
+    uint64_t record_start = 0;
+    while (std::getline(fai, line)) {
+        if (line.empty())
+            continue;
+        std::istringstream fields(line);
+        IndexEntry entry;
+        long long offset, line_bases, line_bytes, qual_offset = -1;
+        if (!std::getline(fields, entry.name, '\t') ||
+                !(fields >> entry.length >> offset >> line_bases >> line_bytes) ||
+                entry.length < 0 || line_bases <= 0 || line_bytes < line_bases) {
+            std::cerr << "Error: could not parse " << fai_filename << "\n";
+            return false;
+        }
+        fields >> qual_offset;
+        entry.record_start = record_start;
+        m_entries.push_back(entry);
+
+        long long data_start = (qual_offset >= 0) ? qual_offset : offset;
+        long long full_lines = entry.length / line_bases;
+        long long remainder = entry.length % line_bases;
+        long long data_bytes = full_lines * line_bytes;
+        if (remainder > 0)
+            data_bytes += remainder + (line_bytes - line_bases);
+        record_start = uint64_t(data_start + data_bytes);
+
+        ++m_record_count;
+        m_total_bases += entry.length;
+    }
+    return true;
+}
+
+
+// The .gzi file is a count followed by (compressed offset, uncompressed offset) pairs for each BGZF block after the
+// first, all as little-endian uint64s.
+bool IndexedReads::load_gzi(std::string gzi_filename) {
+    std::ifstream gzi(gzi_filename, std::ios::binary);
+    uint64_t count = 0;
+    if (!gzi.good() || !gzi.read((char *)&count, sizeof(count))) {
+        std::cerr << "Error: could not read " << gzi_filename << " (compressed input must be BGZF, e.g. from "
+                     "bgzip, and indexed with samtools)\n";
+        return false;
+    }
+    m_blocks.push_back(std::pair<uint64_t, uint64_t>(0, 0));
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t compressed, uncompressed;
+        if (!gzi.read((char *)&compressed, sizeof(compressed)) ||
+                !gzi.read((char *)&uncompressed, sizeof(uncompressed))) {
+            std::cerr << "Error: could not parse " << gzi_filename << "\n";
+            return false;
+        }
+        m_blocks.push_back(std::pair<uint64_t, uint64_t>(uncompressed, compressed));
+    }
+    std::sort(m_blocks.begin(), m_blocks.end());
+    return true;
+}
+
+
+// Chooses the reads to score, using only their lengths. Reads below --min_length always fail, so they're skipped.
+// If the final score only depends on length (zero quality weights) and nothing else can fail a read, the
+// --target_bases/--keep_percent selection can be made here too: only the longest reads up to the target (plus any
+// ties with the last one) are needed. That isn't done for --selection_curve, which needs every read that can pass.
+// With non-zero quality weights, no read can be ruled out by length: the worst read's mean quality score is always
+// normalised to 0, so a long read's score has no lower bound above a short read's highest possible score.
+void IndexedReads::select(Arguments * args) {
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (!args->min_length_set || m_entries[i].length >= args->min_length)
+            candidates.push_back(i);
+    }
+
+    bool length_only_score = (args->mean_q_weight == 0.0 && args->window_q_weight == 0.0);
+    bool only_length_fails = !args->min_mean_q_set && !args->min_window_q_set && !args->exclude_assembly_set &&
+                             !args->trim && !args->split_set && !args->max_depth_set;
+    if (length_only_score && only_length_fails && !args->selection_curve_set &&
+            (args->target_bases_set || args->keep_percent_set)) {
+        long long target_bases = std::numeric_limits<long long>::max();
+        if (args->target_bases_set)
+            target_bases = args->target_bases;
+        if (args->keep_percent_set)
+            target_bases = std::min(target_bases, (long long)((args->keep_percent / 100.0) * m_total_bases));
+
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [this](size_t a, size_t b) {return m_entries[a].length > m_entries[b].length;});
+        long long bases_so_far = 0;
+        size_t keep = 0;
+        while (keep < candidates.size() &&
+               (bases_so_far < target_bases ||
+                (keep > 0 && m_entries[candidates[keep]].length == m_entries[candidates[keep - 1]].length))) {
+            bases_so_far += m_entries[candidates[keep]].length;
+            ++keep;
+        }
+        candidates.resize(keep);
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    m_selected = candidates;
+    m_selected_count = (long long)(m_selected.size());
+    m_selected_bases = 0;
+    for (auto i : m_selected)
+        m_selected_bases += m_entries[i].length;
+    m_next = 0;
+}
+
+
+// Moves fp to the start of the next selected read, which must exist (see done). For BGZF input, the stream is
+// reopened at the read's block when that's quicker, and the old stream is only closed once the new one is open.
+// Returns false (after giving an error) if the read can't be reached.
+bool IndexedReads::seek_next(gzFile & fp) {
+    const IndexEntry & entry = m_entries[m_selected[m_next++]];
+    uint64_t target = entry.record_start;
+    bool found;
+    if (!m_bgzf)
+        found = gzseek(fp, z_off_t(target), SEEK_SET) >= 0;
+    else {
+        uint64_t current = m_stream_start + uint64_t(gztell(fp));
+        if (target >= current && target - current < INDEX_SKIP_LIMIT)
+            found = gzseek(fp, z_off_t(target - m_stream_start), SEEK_SET) >= 0;
+        else {
+            auto block = std::upper_bound(m_blocks.begin(), m_blocks.end(),
+                                          std::pair<uint64_t, uint64_t>(target,
+                                                                        std::numeric_limits<uint64_t>::max()));
+            --block;
+            gzFile block_fp = NULL;
+            int fd = dup(m_fd);
+            if (fd >= 0 && lseek(fd, off_t(block->second), SEEK_SET) >= 0)
+                block_fp = gzdopen(fd, "r");
+            if (block_fp == NULL) {
+                if (fd >= 0)
+                    close(fd);
+                found = false;
+            }
+            else {
+                gzclose(fp);
+                fp = block_fp;
+                m_stream_start = block->first;
+                found = gzseek(fp, z_off_t(target - m_stream_start), SEEK_SET) >= 0;
+            }
+        }
+    }
+    if (!found)
+        std::cerr << "\n\n" << "Error: could not seek to read " << entry.name << " in " << m_filename << "\n";
+    return found;
+}
+
+
+// Makes sure the read just parsed is the one the index says should be there.
+bool IndexedReads::check_record(const char * name, size_t length) {
+    const IndexEntry & entry = m_entries[m_selected[m_next - 1]];
+    if (entry.name != name || entry.length != (long long)length) {
+        std::cerr << "\n\n" << "Error: " << m_filename << ".fai does not match the input reads (expected "
+                  << entry.name << " with " << int_to_string(entry.length) << " bp, found " << name << " with "
+                  << int_to_string((long long)length) << " bp)\n";
+        return false;
+    }
+    return true;
+}
+
+
+// For when the input reads end before the read just sought to, i.e. the index lists reads the file doesn't have.
+void IndexedReads::report_missing_record() {
+    const IndexEntry & entry = m_entries[m_selected[m_next - 1]];
+    std::cerr << "\n\n" << "Error: " << m_filename << " ended before read " << entry.name << " (its .fai index "
+              << "lists more reads than it has)\n";
+}
@@ -0,0 +1,73 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef INDEXED_READS_H
+#define INDEXED_READS_H
+
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <zlib.h>
+
+#include "arguments.h"
+
+
+// Uses a samtools faidx/fqidx index (input_reads.fai, plus input_reads.gzi for BGZF-compressed input) to find reads
+// without decoding the whole file. Reads which can't pass on length alone are never read: the rest are reached by
+// seeking straight to them (or, for BGZF, to the start of the compressed block they're in).
+class IndexedReads
+{
+public:
+    IndexedReads();
+    ~IndexedReads();
+
+    bool load(std::string filename);
+    void select(Arguments * args);
+
+    void restart() {m_next = 0; m_stream_start = 0;}
+    bool done() {return m_next >= m_selected.size();}
+    bool seek_next(gzFile & fp);
+    bool check_record(const char * name, size_t length);
+    void report_missing_record();
+
+    long long m_record_count;
+    long long m_total_bases;
+    long long m_selected_count;
+    long long m_selected_bases;
+
+private:
+    struct IndexEntry {
+        std::string name;
+        long long length;
+        uint64_t record_start;
+    };
+    std::vector<IndexEntry> m_entries;
+    std::vector<size_t> m_selected;
+    size_t m_next;
+
+    std::string m_filename;
+    bool m_bgzf;
+    int m_fd;
+    std::vector<std::pair<uint64_t, uint64_t> > m_blocks;
+    uint64_t m_stream_start;
+
+    bool load_fai(std::string fai_filename);
+    bool load_gzi(std::string gzi_filename);
+};
+
+
+#endif // INDEXED_READS_H
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <zlib.h>
 #include <stdio.h>
+#include <algorithm>
 #include "kseq.h"
 #include "misc.h"
 
@@ -26,6 +27,38 @@ KSEQ_INIT(gzFile, gzread)
 
 
 Kmers::Kmers() {
+    // The Bloom filter is only needed for Illumina read references, so it isn't made until then.
+    bloom = NULL;
+
+    required_kmer_copies = 4;
+    m_keep_single_kmers = false;
+    m_minimizer_window = 0;
+    m_current_source_bit = 0;
+    m_illumina_source_bit = 0;
+    m_score_sources = 0xFF;
+
+    m_track_regions = false;
+    m_reference_length = 0;
+
+    m_min_base_q = 0;
+    m_trim_tail_q = 0;
+    m_low_quality_kmers = 0;
+    m_trimmed_bases = 0;
+}
+
+
+Kmers::~Kmers() {
+    delete bloom;
+}
+
+
+void Kmers::set_illumina_quality_thresholds(int min_base_q, int trim_tail_q) {
+    m_min_base_q = min_base_q;
+    m_trim_tail_q = trim_tail_q;
+}
+
+
+void Kmers::make_bloom_filter() {
     bloom_parameters parameters;
 
     // TO DO: it might be worth experimenting with these values to see how it affects time and memory usage.
@@ -37,31 +70,70 @@ Kmers::Kmers() {
 
     //Instantiate Bloom Filter
     bloom = new bloom_filter(parameters);
+}
 
-    required_kmer_copies = 4;
+
+// Each reference added to the set gets its own bit in the k-mer source bitmasks.
+void Kmers::start_source(std::string name) {
+    m_source_names.push_back(name);
+    m_current_source_bit = uint8_t(1 << (m_source_names.size() - 1));
 }
 
 
-Kmers::~Kmers() {
-    delete bloom;
+// All Illumina reads (whether loaded from an index or hashed from FASTQs) share one source bit.
+void Kmers::start_illumina_source() {
+    if (m_illumina_source_bit == 0) {
+        start_source("illumina_reads");
+        m_illumina_source_bit = m_current_source_bit;
+    }
+    else
+        m_current_source_bit = m_illumina_source_bit;
+}
+
+
+bool Kmers::set_score_source(std::string name) {
+    for (size_t i = 0; i < m_source_names.size(); ++i) {
+        if (m_source_names[i] == name) {
+            m_score_sources = uint8_t(1 << i);
+            return true;
+        }
+    }
+    return false;
 }
 
 
 void Kmers::add_read_fastqs(std::vector<std::string> filenames) {
-    std::cerr << "Hashing 16-mers from Illumina reads\n";
+    if (bloom == NULL)
+        make_bloom_filter();
+
+    if (using_minimizers())
+        std::cerr << "Hashing 16-mer minimizers (w=" << m_minimizer_window << ") from Illumina reads\n";
+    else
+        std::cerr << "Hashing 16-mers from Illumina reads\n";
+    start_illumina_source();
 
     int sequence_count = 0;
     for (auto & filename : filenames)
         sequence_count += add_reference(filename, true);
+    if (m_trim_tail_q > 0)
+        std::cerr << "  " << int_to_string(m_trimmed_bases) << " bp trimmed from low-quality read tails\n";
+    if (m_min_base_q > 0)
+        std::cerr << "  " << int_to_string(m_low_quality_kmers) << " low-quality 16-mers skipped\n";
     std::cerr << "  " << int_to_string(sequence_count) << " reads, "
               << int_to_string(m_kmers.size()) << " 16-mers\n\n";
 }
 
 
-void Kmers::add_assembly_fasta(std::string filename) {
-    std::cerr << "Hashing 16-mers from assembly\n";
+void Kmers::add_assembly_fasta(std::string filename, std::string label) {
+    if (using_minimizers())
+        std::cerr << "Hashing 16-mer minimizers (w=" << m_minimizer_window << ") from " << label << "\n";
+    else
+        std::cerr << "Hashing 16-mers from " << label << "\n";
     std::cerr << "  " << filename << "\n";
+    start_source(filename);
     int sequence_count = add_reference(filename, false);
+    if (m_track_regions)
+        sort_kmer_regions();
     std::string noun;
     if (sequence_count == 1)
         noun = "contig";
@@ -87,6 +159,9 @@ int Kmers::add_reference(std::string filename, bool require_two_kmer_copies) {
     long long base_count = 0;
     long long last_progress = 0;
 
+    // Only assemblies have meaningful positions for depth-aware selection.
+    bool track_regions = m_track_regions && !require_two_kmer_copies;
+
     gzFile fp = gzopen(filename.c_str(), "r");
     kseq_t * seq = kseq_init(fp);
     while ((l = kseq_read(seq)) >= 0) {
@@ -95,30 +170,96 @@ int Kmers::add_reference(std::string filename, bool require_two_kmer_copies) {
         else {
             ++sequence_count;
 
-            // Can't get a 16-mer from a sequence shorter than 16 bp.
-            if (seq->seq.l < 16)
-                continue;
-
-            base_count += seq->seq.l;
             char * sequence = seq->seq.s;
+            int length = int(seq->seq.l);
+
+            // When quality thresholds are set, Illumina reads have their low-quality tails trimmed off and any k-mer
+            // containing a low-quality base is skipped.
+            char * qscores = NULL;
+            if (require_two_kmer_copies && seq->qual.l == seq->seq.l && (m_min_base_q > 0 || m_trim_tail_q > 0))
+                qscores = seq->qual.s;
+            if (qscores != NULL && m_trim_tail_q > 0) {
+                int trimmed_length = length;
+                while (trimmed_length > 0 && qscores[trimmed_length - 1] - 33 < m_trim_tail_q)
+                    --trimmed_length;
+                m_trimmed_bases += length - trimmed_length;
+                length = trimmed_length;
+            }
+            if (m_min_base_q <= 0)
+                qscores = NULL;
 
-            // Build the starting k-mers from the first 16 bases.
-            forward_kmer = starting_kmer_to_bits_forward(sequence);
-            reverse_kmer = starting_kmer_to_bits_reverse(sequence);
-
-            (this->*add_kmer)(forward_kmer);
-            (this->*add_kmer)(reverse_kmer);
-
-            for (size_t i = 16; i < seq->seq.l; ++i) {
-                forward_kmer <<= 2;
-                forward_kmer |= base_to_bits_forward(sequence[i]);
+            // Can't get a 16-mer from a sequence shorter than 16 bp.
+            if (length < 16)
+                continue;
 
-                reverse_kmer >>= 2;
-                reverse_kmer |= base_to_bits_reverse(sequence[i]);
+            base_count += length;
+
+            // In minimizer mode, only the sequence's (canonical) minimizers go into the set.
+            if (using_minimizers()) {
+                MinimizerScanner minimizers(this, sequence, length);
+                int position;
+                uint32_t minimizer;
+                while (minimizers.next(position, minimizer)) {
+                    if (qscores != NULL && !all_bases_pass_quality(qscores + position)) {
+                        ++m_low_quality_kmers;
+                        continue;
+                    }
+                    (this->*add_kmer)(minimizer);
+                    if (track_regions)
+                        add_kmer_region(minimizer, m_reference_length + position);
+                }
+            }
 
-                (this->*add_kmer)(forward_kmer);
-                (this->*add_kmer)(reverse_kmer);
+            // Otherwise every k-mer goes into the set, in both orientations. last_bad_base tracks the most recent
+            // low-quality base, so a k-mer ending at i is only added if that base is more than 15 bases back.
+            else {
+                int last_bad_base = -1;
+                if (qscores != NULL) {
+                    for (int i = 0; i < 16; ++i) {
+                        if (qscores[i] - 33 < m_min_base_q)
+                            last_bad_base = i;
+                    }
+                }
+
+                // Build the starting k-mers from the first 16 bases.
+                forward_kmer = starting_kmer_to_bits_forward(sequence);
+                reverse_kmer = starting_kmer_to_bits_reverse(sequence);
+
+                if (last_bad_base == -1) {
+                    (this->*add_kmer)(forward_kmer);
+                    (this->*add_kmer)(reverse_kmer);
+                }
+                else
+                    ++m_low_quality_kmers;
+                if (track_regions) {
+                    add_kmer_region(forward_kmer, m_reference_length);
+                    add_kmer_region(reverse_kmer, m_reference_length);
+                }
+
+                for (int i = 16; i < length; ++i) {
+                    forward_kmer <<= 2;
+                    forward_kmer |= base_to_bits_forward(sequence[i]);
+
+                    reverse_kmer >>= 2;
+                    reverse_kmer |= base_to_bits_reverse(sequence[i]);
+
+                    if (qscores != NULL && qscores[i] - 33 < m_min_base_q)
+                        last_bad_base = i;
+                    if (last_bad_base > i - 16) {
+                        ++m_low_quality_kmers;
+                        continue;
+                    }
+
+                    (this->*add_kmer)(forward_kmer);
+                    (this->*add_kmer)(reverse_kmer);
+                    if (track_regions) {
+                        add_kmer_region(forward_kmer, m_reference_length + i - 15);
+                        add_kmer_region(reverse_kmer, m_reference_length + i - 15);
+                    }
+                }
             }
+            if (track_regions)
+                m_reference_length += length;
 
             if (base_count - last_progress >= 483611) {  // a big prime number so progress updates don't round off
                 last_progress = base_count;
@@ -134,19 +275,32 @@ int Kmers::add_reference(std::string filename, bool require_two_kmer_copies) {
 }
 
 
+bool Kmers::all_bases_pass_quality(char * qscores) {
+    for (int i = 0; i < 16; ++i) {
+        if (qscores[i] - 33 < m_min_base_q)
+            return false;
+    }
+    return true;
+}
+
+
 void Kmers::add_kmer_require_one_copy(uint32_t kmer) {
-    m_kmers.insert(kmer);
+    m_kmers[kmer] |= m_current_source_bit;
 }
 
 
 void Kmers::add_kmer_require_multiple_copies(uint32_t kmer) {
-    // If the kmer is already in the final set, then we can skip the rest of this function.
-    if (m_kmers.find(kmer) != m_kmers.end())
+    // If the kmer is already in the final set for this source, then we can skip the rest of this function.
+    auto existing = m_kmers.find(kmer);
+    if (existing != m_kmers.end() && (existing->second & m_current_source_bit))
         return;
 
     // Check the bloom filter. If it's not in there, this is definitely the first time it's been seen.
-    if (!bloom->contains(kmer))
+    if (!bloom->contains(kmer)) {
         bloom->insert(kmer);
+        if (m_keep_single_kmers)
+            m_single_kmers.push_back(kmer);
+    }
 
     // If it's in the bloom filter, then it's probably been seen once before (though maybe not, based on the false
     // positive rate of the bloom filter. Next we check the k-mer counts. If it's not in there, we say it's the second
@@ -159,19 +313,302 @@ void Kmers::add_kmer_require_multiple_copies(uint32_t kmer) {
     else {
         int times_seen = ++m_kmer_counts[kmer];
         if (times_seen >= required_kmer_copies) {
-            m_kmers.insert(kmer);
+            m_kmers[kmer] |= m_current_source_bit;
             m_kmer_counts.erase(kmer);
         }
     }
 }
 
+// The Illumina k-mer index is a gzipped binary file holding everything add_kmer_require_multiple_copies knows: the
+// solid k-mers, the counts of k-mers seen more than once but not yet solid, and the k-mers seen only once. K-mer lists
+// are sorted and delta-encoded as varints, so the index grows with the number of distinct k-mers (a few bytes each).
+// The Bloom filter isn't saved: every k-mer ever seen was inserted into it, so inserting all three lists on loading
+// rebuilds exactly the same filter. Loading an index and then adding more Illumina reads therefore gives the same
+// k-mer set as hashing all of the reads at once.
+static const char INDEX_MAGIC[8] = {'F', 'L', 'K', 'M', 'I', 'D', 'X', '2'};
+
+
+static void write_varint(std::string & buffer, uint64_t value) {
+    while (value >= 128) {
+        buffer.push_back(char((value & 127) | 128));
+        value >>= 7;
+    }
+    buffer.push_back(char(value));
+}
+
+
+static bool read_varint(gzFile fp, uint64_t & value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = gzgetc(fp);
+        if (c < 0)
+            return false;
+        value |= uint64_t(c & 127) << shift;
+        if ((c & 128) == 0)
+            return true;
+    }
+    return false;
+}
+
+
+static bool flush_buffer(gzFile fp, std::string & buffer) {
+    if (buffer.empty())
+        return true;
+    bool good = gzwrite(fp, buffer.data(), unsigned(buffer.size())) == int(buffer.size());
+    buffer.clear();
+    return good;
+}
+
+
+bool Kmers::save_illumina_index(std::string filename) {
+    std::cerr << "Saving Illumina 16-mer index\n";
+    std::cerr << "  " << filename << "\n";
+    gzFile fp = gzopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        std::cerr << "Error: could not write to " << filename << "\n";
+        return false;
+    }
+    if (bloom == NULL)
+        make_bloom_filter();
+
+    std::vector<uint32_t> solid;
+    for (auto & kmer : m_kmers) {
+        if (kmer.second & m_illumina_source_bit)
+            solid.push_back(kmer.first);
+    }
+    std::sort(solid.begin(), solid.end());
+    std::vector<uint32_t> counted;
+    for (auto & kmer : m_kmer_counts)
+        counted.push_back(kmer.first);
+    std::sort(counted.begin(), counted.end());
+
+    // K-mers recorded on their first sighting may have been seen again since, so those are left out.
+    std::vector<uint32_t> single;
+    for (auto kmer : m_single_kmers) {
+        auto existing = m_kmers.find(kmer);
+        if (m_kmer_counts.find(kmer) == m_kmer_counts.end() &&
+                (existing == m_kmers.end() || !(existing->second & m_illumina_source_bit)))
+            single.push_back(kmer);
+    }
+    std::sort(single.begin(), single.end());
+
+    bool good = true;
+    std::string buffer(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    write_varint(buffer, uint64_t(m_minimizer_window));
+    write_varint(buffer, uint64_t(m_min_base_q));
+    write_varint(buffer, uint64_t(m_trim_tail_q));
+
+    write_varint(buffer, solid.size());
+    uint32_t previous = 0;
+    for (auto kmer : solid) {
+        write_varint(buffer, kmer - previous);
+        previous = kmer;
+        if (buffer.size() >= 1048576)
+            good = flush_buffer(fp, buffer) && good;
+    }
+
+    write_varint(buffer, counted.size());
+    previous = 0;
+    for (auto kmer : counted) {
+        write_varint(buffer, kmer - previous);
+        buffer.push_back(char(m_kmer_counts[kmer]));
+        previous = kmer;
+        if (buffer.size() >= 1048576)
+            good = flush_buffer(fp, buffer) && good;
+    }
+
+    write_varint(buffer, single.size());
+    previous = 0;
+    for (auto kmer : single) {
+        write_varint(buffer, kmer - previous);
+        previous = kmer;
+        if (buffer.size() >= 1048576)
+            good = flush_buffer(fp, buffer) && good;
+    }
+    good = flush_buffer(fp, buffer) && good;
+
+    good = (gzclose(fp) == Z_OK) && good;
+    if (!good) {
+        std::cerr << "Error: could not write to " << filename << "\n";
+        return false;
+    }
+    std::cerr << "  " << int_to_string(solid.size()) << " 16-mers, "
+              << int_to_string(counted.size()) << " counted 16-mers, "
+              << int_to_string(single.size()) << " single 16-mers\n\n";
+    return true;
+}
+
 
+bool Kmers::load_illumina_index(std::string filename) {
+    std::cerr << "Loading Illumina 16-mer index\n";
+    std::cerr << "  " << filename << "\n";
+    gzFile fp = gzopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        std::cerr << "Error: could not read " << filename << "\n";
+        return false;
+    }
+    if (bloom == NULL)
+        make_bloom_filter();
+    start_illumina_source();
+
+    char magic[sizeof(INDEX_MAGIC)];
+    uint64_t minimizer_window, min_base_q, trim_tail_q;
+    bool good = gzread(fp, magic, sizeof(magic)) == int(sizeof(magic)) &&
+                std::equal(magic, magic + sizeof(magic), INDEX_MAGIC) &&
+                read_varint(fp, minimizer_window) && read_varint(fp, min_base_q) && read_varint(fp, trim_tail_q);
+    if (!good) {
+        std::cerr << "Error: " << filename << " is not a Filtlong k-mer index\n";
+        gzclose(fp);
+        return false;
+    }
+
+    // The index can only be added to with the same settings it was built with.
+    if (int(minimizer_window) != m_minimizer_window || int(min_base_q) != m_min_base_q ||
+            int(trim_tail_q) != m_trim_tail_q) {
+        std::cerr << "Error: " << filename << " was built with different --minimizer_window, --illumina_min_q or "
+                     "--illumina_trim_q settings\n";
+        gzclose(fp);
+        return false;
+    }
+
+    uint64_t solid_count = 0, counted_count = 0, single_count = 0, delta;
+    good = read_varint(fp, solid_count);
+    uint32_t kmer = 0;
+    for (uint64_t i = 0; good && i < solid_count; ++i) {
+        good = read_varint(fp, delta);
+        kmer += uint32_t(delta);
+        m_kmers[kmer] |= m_illumina_source_bit;
+        bloom->insert(kmer);
+    }
+    good = good && read_varint(fp, counted_count);
+    kmer = 0;
+    for (uint64_t i = 0; good && i < counted_count; ++i) {
+        good = read_varint(fp, delta);
+        kmer += uint32_t(delta);
+        int count = gzgetc(fp);
+        good = good && count >= 0;
+        m_kmer_counts[kmer] = count;
+        bloom->insert(kmer);
+    }
+    good = good && read_varint(fp, single_count);
+    kmer = 0;
+    for (uint64_t i = 0; good && i < single_count; ++i) {
+        good = read_varint(fp, delta);
+        kmer += uint32_t(delta);
+        bloom->insert(kmer);
+        if (m_keep_single_kmers)
+            m_single_kmers.push_back(kmer);
+    }
+    gzclose(fp);
+    if (!good) {
+        std::cerr << "Error: " << filename << " is truncated or corrupt\n";
+        return false;
+    }
+    std::cerr << "  " << int_to_string(solid_count) << " 16-mers, "
+              << int_to_string(counted_count) << " counted 16-mers, "
+              << int_to_string(single_count) << " single 16-mers\n\n";
+    return true;
+}
+
+
+// Records which reference region a k-mer is in, if it's one of the sampled k-mers. Minimizers are already a sample, so
+// they're all kept. Sampling by hash (not position) means a repeat's copies all record the same k-mers, so each of
+// those k-mers gets every copy's region. At about two bytes per assembly base (in both orientations) this is much
+// smaller than the k-mer set itself.
+void Kmers::add_kmer_region(uint32_t kmer, long long position) {
+    if (using_minimizers() || hash_kmer(kmer) % DEPTH_REGION_STRIDE == 0)
+        m_kmer_regions.push_back(std::pair<uint32_t, uint32_t>(kmer, uint32_t(position / DEPTH_REGION_SIZE)));
+}
+
+
+void Kmers::sort_kmer_regions() {
+    std::sort(m_kmer_regions.begin(), m_kmer_regions.end());
+    m_kmer_regions.erase(std::unique(m_kmer_regions.begin(), m_kmer_regions.end()), m_kmer_regions.end());
+    m_kmer_regions.shrink_to_fit();
+}
+
+
+// Gives the number of regions a k-mer is in (more than one for a repeat) and the index of the first, for region_at.
+int Kmers::get_kmer_regions(uint32_t kmer, size_t & first) {
+    auto range = std::equal_range(m_kmer_regions.begin(), m_kmer_regions.end(),
+                                  std::pair<uint32_t, uint32_t>(kmer, 0),
+                                  [](const std::pair<uint32_t, uint32_t> & a, const std::pair<uint32_t, uint32_t> & b)
+                                  {return a.first < b.first;});
+    first = size_t(range.first - m_kmer_regions.begin());
+    return int(range.second - range.first);
+}
 
 bool Kmers::is_kmer_present(uint32_t kmer) {
     return m_kmers.find(kmer) != m_kmers.end();
 }
 
 
+// Returns the fraction of 16-mers (or minimizers) from the first reads of a file which are in the set. This is a
+// cheap sanity check that the reference actually matches the reads.
+double Kmers::sample_hit_fraction(std::string filename, int max_reads, int & reads_checked) {
+    long long total = 0, hits = 0;
+    reads_checked = 0;
+
+    int l;
+    gzFile fp = gzopen(filename.c_str(), "r");
+    kseq_t * seq = kseq_init(fp);
+    while (reads_checked < max_reads && (l = kseq_read(seq)) >= 0) {
+        int length = int(seq->seq.l);
+        if (l == -3 || length < 16)
+            continue;
+        ++reads_checked;
+        char * sequence = seq->seq.s;
+        if (using_minimizers()) {
+            MinimizerScanner minimizers(this, sequence, length);
+            int position;
+            uint32_t minimizer;
+            while (minimizers.next(position, minimizer)) {
+                ++total;
+                if (is_kmer_present(minimizer))
+                    ++hits;
+            }
+        }
+        else {
+            uint32_t kmer = starting_kmer_to_bits_forward(sequence);
+            for (int i = 15; i < length; ++i) {
+                if (i > 15) {
+                    kmer <<= 2;
+                    kmer |= base_to_bits_forward(sequence[i]);
+                }
+                ++total;
+                if (is_kmer_present(kmer))
+                    ++hits;
+            }
+        }
+    }
+    kseq_destroy(seq);
+    gzclose(fp);
+
+    if (total == 0)
+        return 1.0;
+    return double(hits) / double(total);
+}
+
+
+uint8_t Kmers::get_kmer_sources(uint32_t kmer) {
+    auto found = m_kmers.find(kmer);
+    if (found == m_kmers.end())
+        return 0;
+    return found->second;
+}
+
+
+// Thomas Wang's invertible 32-bit integer hash. Minimizers are chosen by hash value rather than k-mer value so that
+// low-complexity k-mers (e.g. poly-A) aren't always picked.
+uint32_t Kmers::hash_kmer(uint32_t kmer) {
+    kmer = (kmer ^ 61) ^ (kmer >> 16);
+    kmer = kmer + (kmer << 3);
+    kmer = kmer ^ (kmer >> 4);
+    kmer = kmer * 0x27d4eb2d;
+    kmer = kmer ^ (kmer >> 15);
+    return kmer;
+}
+
 
 uint32_t Kmers::base_to_bits_forward(char base) {
     switch (base) {
@@ -237,3 +674,65 @@ uint32_t Kmers::starting_kmer_to_bits_reverse(char * sequence) {
     }
     return kmer;
 }
+
+
+MinimizerScanner::MinimizerScanner(Kmers * kmers, char * sequence, int length) {
+    m_kmers = kmers;
+    m_sequence = sequence;
+    m_kmer_count = std::max(0, length - 15);
+    m_window = std::min(kmers->minimizer_window(), m_kmer_count);
+    m_next_kmer = 0;
+    m_last_position = -1;
+    m_forward_kmer = 0;
+    m_reverse_kmer = 0;
+    m_candidates.resize(size_t(std::max(1, m_window)));
+    m_front = 0;
+    m_size = 0;
+}
+
+
+bool MinimizerScanner::next(int & position, uint32_t & kmer) {
+    while (m_next_kmer < m_kmer_count) {
+        int i = m_next_kmer++;
+        if (i == 0) {
+            m_forward_kmer = m_kmers->starting_kmer_to_bits_forward(m_sequence);
+            m_reverse_kmer = m_kmers->starting_kmer_to_bits_reverse(m_sequence);
+        }
+        else {
+            m_forward_kmer <<= 2;
+            m_forward_kmer |= m_kmers->base_to_bits_forward(m_sequence[i + 15]);
+            m_reverse_kmer >>= 2;
+            m_reverse_kmer |= m_kmers->base_to_bits_reverse(m_sequence[i + 15]);
+        }
+        Candidate candidate;
+        candidate.position = i;
+        uint32_t forward_hash = m_kmers->hash_kmer(m_forward_kmer);
+        uint32_t reverse_hash = m_kmers->hash_kmer(m_reverse_kmer);
+        candidate.hash = std::min(forward_hash, reverse_hash);
+        candidate.kmer = (forward_hash <= reverse_hash) ? m_forward_kmer : m_reverse_kmer;
+
+        // Drop the k-mer which just left the window, then any k-mers which can't be a minimizer now that this one has
+        // arrived (ties keep the earlier k-mer).
+        size_t capacity = m_candidates.size();
+        int window_start = i - m_window + 1;
+        if (m_size > 0 && m_candidates[m_front].position < window_start) {
+            m_front = (m_front + 1) % capacity;
+            --m_size;
+        }
+        while (m_size > 0 && m_candidates[(m_front + m_size - 1) % capacity].hash > candidate.hash)
+            --m_size;
+        m_candidates[(m_front + m_size) % capacity] = candidate;
+        ++m_size;
+
+        if (window_start < 0)
+            continue;
+        const Candidate & minimizer = m_candidates[m_front];
+        if (minimizer.position != m_last_position) {
+            m_last_position = minimizer.position;
+            position = minimizer.position;
+            kmer = minimizer.kmer;
+            return true;
+        }
+    }
+    return false;
+}
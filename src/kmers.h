@@ -21,9 +21,20 @@
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
+#include <utility>
+#include <stdint.h>
 #include "bloom_filter.h"
 
 
+#define MAX_REFERENCE_SOURCES 8
+
+// For depth-aware selection, assemblies are divided into regions of this many bases, and the regions of a sample of
+// the assembly k-mers (one in every stride, chosen by k-mer hash so every copy of a repeat gives the same k-mers) are
+// recorded.
+#define DEPTH_REGION_SIZE 1000
+#define DEPTH_REGION_STRIDE 8
+
+
 class Kmers
 {
 public:
@@ -32,9 +43,36 @@ public:
 
     bool empty() {return m_kmers.size() == 0;}
 
+    void set_minimizer_window(int window) {m_minimizer_window = window;}
+    bool using_minimizers() {return m_minimizer_window > 0;}
+    int minimizer_window() {return m_minimizer_window;}
+
+    void set_illumina_quality_thresholds(int min_base_q, int trim_tail_q);
+
+    // K-mers seen only once are only remembered (beyond the Bloom filter) if an index will be saved.
+    void keep_single_kmers() {m_keep_single_kmers = true;}
     void add_read_fastqs(std::vector<std::string> filenames);
-    void add_assembly_fasta(std::string filename);
+    bool load_illumina_index(std::string filename);
+    bool save_illumina_index(std::string filename);
+    void add_assembly_fasta(std::string filename, std::string label);
     bool is_kmer_present(uint32_t kmer);
+    double sample_hit_fraction(std::string filename, int max_reads, int & reads_checked);
+
+    // Each k-mer stores a bitmask of which references (assemblies or the Illumina reads) it came from.
+    uint8_t get_kmer_sources(uint32_t kmer);
+    int source_count() {return int(m_source_names.size());}
+    std::string source_name(int i) {return m_source_names[i];}
+
+    // By default a k-mer from any reference counts as a hit when scoring reads, but scoring can be limited to one.
+    bool set_score_source(std::string name);
+    uint8_t score_sources() {return m_score_sources;}
+
+    // Reference regions are only tracked if enabled before the assemblies are added.
+    void track_regions() {m_track_regions = true;}
+    bool tracking_regions() {return m_track_regions;}
+    int get_kmer_regions(uint32_t kmer, size_t & first);
+    uint32_t region_at(size_t i) {return m_kmer_regions[i].second;}
+    uint32_t region_count() {return uint32_t((m_reference_length + DEPTH_REGION_SIZE - 1) / DEPTH_REGION_SIZE);}
 
     uint32_t starting_kmer_to_bits_forward(char * sequence);
     uint32_t starting_kmer_to_bits_reverse(char * sequence);
@@ -42,15 +80,77 @@ public:
     uint32_t base_to_bits_forward(char base);
     uint32_t base_to_bits_reverse(char base);
 
+    uint32_t hash_kmer(uint32_t kmer);
+
 private:
-    std::unordered_set<uint32_t> m_kmers;
+    std::unordered_map<uint32_t, uint8_t> m_kmers;
     std::unordered_map<uint32_t, int> m_kmer_counts;
     bloom_filter * bloom;
     int required_kmer_copies;
+    bool m_keep_single_kmers;
+    std::vector<uint32_t> m_single_kmers;
+    int m_minimizer_window;
+
+    std::vector<std::string> m_source_names;
+    uint8_t m_current_source_bit;
+    uint8_t m_illumina_source_bit;
+    uint8_t m_score_sources;
+
+    bool m_track_regions;
+    // (k-mer, region) pairs sorted by k-mer, 8 bytes each. A repeated k-mer has a pair for each region it is in.
+    std::vector<std::pair<uint32_t, uint32_t> > m_kmer_regions;
+    long long m_reference_length;
+
+    int m_min_base_q;
+    int m_trim_tail_q;
+    long long m_low_quality_kmers;
+    long long m_trimmed_bases;
 
     int add_reference(std::string filename, bool require_two_kmer_copies);
     void add_kmer_require_one_copy(uint32_t kmer);
     void add_kmer_require_multiple_copies(uint32_t kmer);
+    void add_kmer_region(uint32_t kmer, long long position);
+    void sort_kmer_regions();
+    void make_bloom_filter();
+    void start_source(std::string name);
+    void start_illumina_source();
+
+    bool all_bases_pass_quality(char * qscores);
+};
+
+
+// Gives the (position, canonical k-mer) of each (w,16)-minimizer in a sequence, where w is the Kmers object's
+// minimizer window. The canonical k-mer is whichever of the forward and reverse complement k-mers has the lower hash,
+// so a sequence and its reverse complement share minimizers. Consecutive windows with the same minimizer only give it
+// once. Only the current window is held in memory, so this works for sequences of any size.
+class MinimizerScanner
+{
+public:
+    MinimizerScanner(Kmers * kmers, char * sequence, int length);
+
+    bool next(int & position, uint32_t & kmer);
+
+private:
+    struct Candidate {
+        int position;
+        uint32_t hash;
+        uint32_t kmer;
+    };
+
+    Kmers * m_kmers;
+    char * m_sequence;
+    int m_kmer_count;
+    int m_window;
+    int m_next_kmer;
+    int m_last_position;
+    uint32_t m_forward_kmer;
+    uint32_t m_reverse_kmer;
+
+    // A ring buffer holding the window's k-mers in position order with increasing hashes, so its front is always the
+    // window's minimizer.
+    std::vector<Candidate> m_candidates;
+    size_t m_front;
+    size_t m_size;
 };
 
 
@@ -22,12 +22,20 @@
 #include <unordered_map>
 #include <utility>
 #include <math.h>
+#include <fstream>
 
 #include "kseq.h"
 #include "read.h"
 #include "arguments.h"
 #include "kmers.h"
 #include "misc.h"
+#include "read_ids.h"
+#include "read_writer.h"
+#include "coverage_cache.h"
+#include "selection_curve.h"
+#include "shard_writer.h"
+#include "shm_ring.h"
+#include "indexed_reads.h"
 
 #define PROGRAM_VERSION "0.2.0"
 
@@ -48,14 +56,102 @@ int main(int argc, char **argv)
 
     std::cerr << "\n";
 
+    // If we're just applying a list of read IDs from an earlier run, then there's no scoring to do.
+    if (args.apply_ids_set) {
+        ReadIds read_ids;
+        std::cerr << "Loading read IDs\n";
+        if (!read_ids.load(args.apply_ids))
+            return 1;
+        std::cerr << "  " << int_to_string(read_ids.m_whole_read_count) << " whole reads, "
+                  << int_to_string(read_ids.m_range_count) << " read ranges\n\n";
+        std::cerr << "Outputting listed reads\n";
+        ReadWriter writer(&args, &std::cout);
+        int result = read_ids.apply_to_reads(args.input_reads, writer);
+        std::cerr << "\n";
+        return result;
+    }
+
     // Read through references and save 16-mers. For assembly references, this will save all 16-mers in the assembly.
     // For Illumina read references, the k-mer needs to appear a few times before it's added to the set.
+    // A saved Illumina index is loaded first, so any -1/-2 reads are counted on top of it.
     Kmers kmers;
-    if (args.assembly_set || args.illumina_reads.size() > 0) {
-        if (args.assembly_set)
-            kmers.add_assembly_fasta(args.assembly);
+    if (args.assembly_set || args.illumina_reads.size() > 0 || args.load_kmer_index_set) {
+        if (args.minimizer_window_set)
+            kmers.set_minimizer_window(args.minimizer_window);
+        if (args.max_depth_set)
+            kmers.track_regions();
+        for (auto & assembly : args.assemblies)
+            kmers.add_assembly_fasta(assembly, "assembly");
+        kmers.set_illumina_quality_thresholds(args.illumina_min_q, args.illumina_trim_q);
+        if (args.save_kmer_index_set)
+            kmers.keep_single_kmers();
+        if (args.load_kmer_index_set && !kmers.load_illumina_index(args.load_kmer_index))
+            return 1;
         if (args.illumina_reads.size() > 0)
             kmers.add_read_fastqs(args.illumina_reads);
+        if (args.save_kmer_index_set && !kmers.save_illumina_index(args.save_kmer_index))
+            return 1;
+        if (args.score_reference_set)
+            kmers.set_score_source(args.score_reference);
+    }
+
+    // A reference which gave no 16-mers at all (e.g. all of its bases are below --illumina_min_q) is the clearest sign
+    // of a wrong reference. Without this check, reads would quietly be scored from their qscores instead.
+    bool reference_given = args.assembly_set || args.illumina_reads.size() > 0 || args.load_kmer_index_set;
+    if (reference_given && kmers.empty() && args.reference_check > 0.0) {
+        std::string message = "no 16-mers were taken from the reference, so reads will be scored using their qscores "
+                              "(and --trim/--split will do nothing)";
+        if (args.reference_check_abort) {
+            std::cerr << "Error: " << message << "\n";
+            return 1;
+        }
+        std::cerr << "Warning: " << message << "\n\n";
+    }
+
+    // Before the (possibly long) full scan, make sure the reference actually matches the reads. A wrong reference
+    // gives almost no 16-mer hits, which would otherwise only show up as near-zero qualities at the end.
+    if (!kmers.empty() && args.reference_check > 0.0 && !args.shm_input) {
+        int reads_checked;
+        double hit_fraction = kmers.sample_hit_fraction(args.input_reads, 100, reads_checked);
+        std::cerr << "Checking reference against input reads\n";
+        std::cerr << "  " << int_to_string(reads_checked) << " reads, "
+                  << double_to_string(100.0 * hit_fraction) << "% of 16-mers in reference\n\n";
+        if (hit_fraction < args.reference_check) {
+            std::string message = "less than " + double_to_string(100.0 * args.reference_check) +
+                    "% of 16-mers in the first input reads are in the reference - is it the right one?";
+            if (args.reference_check_abort) {
+                std::cerr << "Error: " << message << "\n";
+                return 1;
+            }
+            std::cerr << "Warning: " << message << "\n\n";
+        }
+    }
+
+    // The exclusion assembly gets its own k-mer set, which is checked during read scoring.
+    Kmers exclude_kmers;
+    if (args.exclude_assembly_set)
+        exclude_kmers.add_assembly_fasta(args.exclude_assembly, "exclusion assembly");
+
+    // Reads from a shared-memory ring buffer are filtered as they arrive, without the two passes below.
+    if (args.shm_input) {
+        ShmRingReader ring;
+        if (!ring.open(args.input_reads))
+            return 1;
+        ReadWriter writer(&args, &std::cout);
+        return filter_ring_stream(ring, &kmers, args.exclude_assembly_set ? &exclude_kmers : NULL, &args, writer);
+    }
+
+    // With a read index, reads which can't pass on length alone are never decompressed or scored.
+    IndexedReads * indexed_input = NULL;
+    if (args.use_index) {
+        indexed_input = new IndexedReads();
+        if (!indexed_input->load(args.input_reads))
+            return 1;
+        indexed_input->select(&args);
+        std::cerr << "  " << int_to_string(indexed_input->m_record_count) << " reads ("
+                  << int_to_string(indexed_input->m_total_bases) << " bp), scoring "
+                  << int_to_string(indexed_input->m_selected_count) << " reads ("
+                  << int_to_string(indexed_input->m_selected_bases) << " bp)\n\n";
     }
 
     // Read through input long reads once, storing them as Read objects and calculating their scores.
@@ -73,10 +169,82 @@ int main(int argc, char **argv)
     bool any_fasta = false;
     bool any_fastq = false;
 
-    while (true) {
+    // When using header qscores, every 100th such read is also scored from its per-base qscores as a consistency check.
+    int header_qscore_reads = 0;
+    int header_qscore_checks = 0;
+    double header_qscore_diff_sum = 0.0;
+
+    int excluded_reads = 0;
+    long long excluded_bases = 0;
+
+    int approximate_reads = 0;
+    double max_mean_quality_error = 0.0;
+    double max_window_quality_error = 0.0;
+
+    std::ofstream coverage_file;
+    if (args.save_coverage_set) {
+        coverage_file.open(args.save_coverage);
+        if (!coverage_file.good()) {
+            std::cerr << "Error: could not write to " << args.save_coverage << "\n";
+            return 1;
+        }
+    }
+
+    // With a coverage cache from an earlier run, the reads are scored from the cache and the input reads aren't
+    // decoded until output.
+    if (args.load_coverage_set) {
+        std::ifstream coverage_cache(args.load_coverage);
+        std::string read_name;
+        std::vector<double> coverage;
+        int result;
+        while ((result = read_coverage(coverage_cache, read_name, coverage)) == 1) {
+            total_bases += coverage.size();
+            Read * read = new Read(read_name, coverage, &args);
+            reads.push_back(read);
+            if (args.verbose)
+                read->print_verbose_read_info();
+
+            if (read_dict.find(read->m_name) != read_dict.end()) {
+                std::cerr << "Error: duplicate read name: " << read->m_name << "\n";
+                return 1;
+            }
+            read_dict[read->m_name] = read;
+
+            if (total_bases - last_progress >= 483611) {  // a big prime number so progress updates don't round off
+                last_progress = total_bases;
+                if (!args.verbose)
+                    print_read_score_progress(reads.size(), total_bases);
+            }
+        }
+        if (result == -1) {
+            std::cerr << "\n\n" << "Error: could not parse coverage cache " << args.load_coverage << "\n";
+            return 1;
+        }
+
+        // The input reads haven't been read yet, so the output format comes from the first one.
+        if (kseq_read(seq) >= 0) {
+            any_fastq = (seq->qual.l > 0);
+            any_fasta = !any_fastq;
+        }
+    }
+
+    while (!args.load_coverage_set) {
+        if (indexed_input != NULL) {
+            if (indexed_input->done())
+                break;
+            if (!indexed_input->seek_next(fp))
+                return 1;
+            seq->f->f = fp;
+            kseq_rewind(seq);
+        }
         l = kseq_read(seq);
-        if (l == -1)  // end of file
+        if (l == -1) {  // end of file
+            if (indexed_input != NULL) {
+                indexed_input->report_missing_record();
+                return 1;
+            }
             break;
+        }
         if (l == -2) {
             std::cerr << "Error: incorrect FASTQ format for read " << seq->name.s << "\n";
             return 1;
@@ -86,6 +254,8 @@ int main(int argc, char **argv)
             return 1;
         }
         else {
+            if (indexed_input != NULL && !indexed_input->check_record(seq->name.s, seq->seq.l))
+                return 1;
             total_bases += seq->seq.l;
             std::string read_name = seq->name.s;
 
@@ -105,8 +275,38 @@ int main(int argc, char **argv)
                 return 1;
             }
 
-            Read * read = new Read(read_name, seq->seq.s, seq->qual.s, int(seq->seq.l), &kmers, &args);
+            double header_qscore = -1.0;
+            if (args.header_qscore && seq->comment.l > 0)
+                parse_header_qscore(seq->comment.s, header_qscore);
+
+            Read * read = new Read(read_name, seq->seq.s, seq->qual.s, int(seq->seq.l), &kmers,
+                                   args.exclude_assembly_set ? &exclude_kmers : NULL, &args, header_qscore);
             reads.push_back(read);
+
+            if (args.save_coverage_set) {
+                write_coverage(coverage_file, read);
+                std::vector<std::pair<int,int> >().swap(read->m_covered_ranges);
+            }
+
+            if (read->m_excluded) {
+                ++excluded_reads;
+                excluded_bases += read->m_length;
+            }
+
+            if (read->m_approximate) {
+                ++approximate_reads;
+                max_mean_quality_error = std::max(max_mean_quality_error, read->m_mean_quality_error);
+                max_window_quality_error = std::max(max_window_quality_error, read->m_window_quality_error);
+            }
+
+            if (header_qscore >= 0.0) {
+                if (header_qscore_reads % 100 == 0) {
+                    double diff = read->m_mean_quality - read->get_qscore_mean_quality(seq->qual.s);
+                    header_qscore_diff_sum += fabs(diff);
+                    ++header_qscore_checks;
+                }
+                ++header_qscore_reads;
+            }
             if (args.verbose)
                 read->print_verbose_read_info();
 
@@ -129,8 +329,48 @@ int main(int argc, char **argv)
         print_read_score_progress(reads.size(), total_bases);
     std::cerr << "\n";
 
+    // Reads skipped using the index still count towards the total, so --keep_percent means the same thing.
+    if (indexed_input != NULL)
+        total_bases = indexed_input->m_total_bases;
+    if (args.exclude_assembly_set)
+        std::cerr << "  excluded: " << int_to_string(excluded_reads) << " reads ("
+                  << int_to_string(excluded_bases) << " bp)\n";
+    if (approximate_reads > 0)
+        std::cerr << "  approximate qualities: " << int_to_string(approximate_reads) << " reads, "
+                  << "max mean quality error = " << double_to_string(max_mean_quality_error) << ", "
+                  << "max window quality error = " << double_to_string(max_window_quality_error) << "\n";
+    if (args.header_qscore) {
+        std::cerr << "  mean quality from header qscores: " << int_to_string(header_qscore_reads) << " reads, "
+                  << "from per-base qscores: " << int_to_string(reads.size() - header_qscore_reads) << " reads\n";
+        if (header_qscore_checks > 0) {
+            double mean_diff = header_qscore_diff_sum / header_qscore_checks;
+            std::cerr << "  header qscore check: " << int_to_string(header_qscore_checks) << " reads sampled, "
+                      << "mean difference = " << double_to_string(mean_diff) << "\n";
+            if (mean_diff > 1.0)
+                std::cerr << "  Warning: header qscores do not agree well with per-base qscores\n";
+        }
+    }
+
+    // With more than one reference, each read's hit fraction per reference can be saved to a table.
+    if (args.reference_report_set) {
+        std::ofstream report(args.reference_report);
+        if (!report.good()) {
+            std::cerr << "Error: could not write to " << args.reference_report << "\n";
+            return 1;
+        }
+        report << "read_name\tlength";
+        for (int i = 0; i < kmers.source_count(); ++i)
+            report << "\t" << kmers.source_name(i);
+        report << "\n";
+        for (auto read : reads) {
+            report << read->m_name << "\t" << read->m_length;
+            for (auto fraction : read->m_source_fractions)
+                report << "\t" << fraction;
+            report << "\n";
+        }
+    }
+
     // Determine the output format.
-    bool fasta_output = any_fasta;
     bool fastq_output = any_fastq;
 
     // Gather up reads to output. If a read has been trimmed/split, it's these child reads which we use, not the
@@ -203,6 +443,7 @@ int main(int argc, char **argv)
         double window_ratio = read->m_window_quality / read->m_mean_quality;
         if (window_ratio > 1.0)
             window_ratio = 1.0;
+        read->m_raw_mean_quality = read->m_mean_quality;
         double quality_z_score = (read->m_mean_quality - mean_quality) / stdev_quality;
         read->m_mean_quality = 100.0 * (quality_z_score - min_z_score) / max_min_z_diff;
         read->m_window_quality = read->m_mean_quality * window_ratio;
@@ -213,6 +454,56 @@ int main(int argc, char **argv)
     if (args.verbose)
         std::cerr << "\n";
 
+    // With --max_depth, reads are taken from best to worst and any read whose reference regions are all already at the
+    // maximum depth fails. Reads which don't hit any region aren't affected. This happens before the --target_bases and
+    // --keep_percent filtering, so those fill up with reads from regions which still need depth.
+    if (args.max_depth_set) {
+        std::cerr << "Capping reference depth\n";
+        std::vector<Read*> by_score(reads2);
+        std::stable_sort(by_score.begin(), by_score.end(),
+                         [](const Read* a, const Read* b) {return a->m_final_score > b->m_final_score;});
+        std::vector<uint16_t> depths(kmers.region_count(), 0);
+        long long capped_reads = 0;
+        long long capped_bases = 0;
+        for (auto read : by_score) {
+            if (!read->m_passed || read->m_region_placements.empty())
+                continue;
+
+            // A read entirely in a repeat could be from any copy, so it goes to whichever copy needs it most.
+            std::vector<uint32_t> * placement = NULL;
+            size_t most_open_regions = 0;
+            for (auto & regions : read->m_region_placements) {
+                size_t open_regions = 0;
+                for (auto region : regions) {
+                    if (depths[region] < args.max_depth)
+                        ++open_regions;
+                }
+                if (open_regions > most_open_regions) {
+                    placement = &regions;
+                    most_open_regions = open_regions;
+                }
+            }
+            if (placement == NULL) {
+                read->m_passed = false;
+                ++capped_reads;
+                capped_bases += read->m_length;
+                continue;
+            }
+            for (auto region : *placement) {
+                if (depths[region] < std::numeric_limits<uint16_t>::max())
+                    ++depths[region];
+            }
+        }
+        std::cerr << "  " << int_to_string(capped_reads) << " reads (" << int_to_string(capped_bases)
+                  << " bp) in regions already at depth " << args.max_depth << "\n\n";
+    }
+
+    // The selection curve is made from the reads which can still be kept, so it comes after depth capping.
+    if (args.selection_curve_set) {
+        if (!write_selection_curve(args.selection_curve, reads2, total_bases))
+            return 1;
+    }
+
     // If the user set thresholds using either --target_bases or --keep_percent, then we need to see which additional
     // reads should be labelled as failed.
     if (args.target_bases_set || args.keep_percent_set) {
@@ -262,23 +553,66 @@ int main(int argc, char **argv)
 
     // Read through input reads again, this time outputting the keepers to stdout and ignoring the failures.
     std::cerr << "Outputting passed long reads\n";
+    std::ofstream ids_file;
+    if (args.write_ids_set) {
+        ids_file.open(args.write_ids);
+        if (!ids_file.good()) {
+            std::cerr << "Error: could not write to " << args.write_ids << "\n";
+            return 1;
+        }
+    }
+    ReadWriter writer(&args, &std::cout);
+    ShardWriter * shard_writer = NULL;
+    if (args.shard_output_set) {
+        std::string extension = (fastq_output && !args.fasta_output) ? ".fastq.gz" : ".fasta.gz";
+        shard_writer = new ShardWriter(&args, extension);
+        if (!shard_writer->open()) {
+            delete shard_writer;
+            return 1;
+        }
+    }
     fp = gzopen(args.input_reads.c_str(), "r");
     seq = kseq_init(fp);
-    while ((l = kseq_read(seq)) >= 0) {
-        Read * read = read_dict[seq->name.s];
+    if (indexed_input != NULL)
+        indexed_input->restart();
+    while (true) {
+        if (indexed_input != NULL) {
+            if (indexed_input->done())
+                break;
+            if (!indexed_input->seek_next(fp))
+                return 1;
+            seq->f->f = fp;
+            kseq_rewind(seq);
+        }
+        if ((l = kseq_read(seq)) < 0) {
+            if (indexed_input != NULL) {
+                indexed_input->report_missing_record();
+                return 1;
+            }
+            break;
+        }
+        if (indexed_input != NULL && !indexed_input->check_record(seq->name.s, seq->seq.l))
+            return 1;
+        auto found = read_dict.find(seq->name.s);
+        if (found == read_dict.end()) {
+            std::cerr << "Error: read " << seq->name.s << " was not scored";
+            if (args.load_coverage_set)
+                std::cerr << " (is the coverage cache from this input?)";
+            std::cerr << "\n";
+            return 1;
+        }
+        Read * read = found->second;
+        char * qual = (fastq_output && seq->qual.l > 0) ? seq->qual.s : NULL;
+        char * comment = (seq->comment.l > 0) ? seq->comment.s : NULL;
 
         if (read->m_child_reads.size() == 0) {
             if (read->m_passed) {
-                std::cout << (fasta_output ? ">" : "@");
-                std::cout << seq->name.s;
-                if (seq->comment.l > 0)
-                    std::cout << " " << seq->comment.s;
-                std::cout << "\n";
-                std::cout << seq->seq.s << "\n";
-                if (fastq_output) {
-                    std::cout << "+\n";
-                    std::cout << seq->qual.s << "\n";
-                }
+                if (args.write_ids_set)
+                    ids_file << read->m_name << "\n";
+                if (shard_writer != NULL)
+                    shard_writer->write(seq->name.s, comment, seq->seq.s, qual, int(seq->seq.l));
+                else
+                    writer.write(seq->name.s, comment, seq->seq.s, qual, int(seq->seq.l));
             }
         }
         else {
@@ -290,20 +624,15 @@ int main(int argc, char **argv)
                     int end = child_read_range.second;
                     int length = end - start;
                     if (length > 0) {
-                        std::cout << (fasta_output ? ">" : "@");
-                        std::cout << child_read->m_name;
-                        if (seq->comment.l > 0)
-                            std::cout << " " << seq->comment.s;
-                        std::cout << "\n";
-
-                        std::string seq_str = seq->seq.s;
-                        std::cout << seq_str.substr(start, length) << "\n";
-
-                        if (fastq_output) {
-                            std::string qual_str = seq->qual.s;
-                            std::cout << "+\n";
-                            std::cout << qual_str.substr(start, length) << "\n";
-                        }
+                        if (args.write_ids_set)
+                            ids_file << read->m_name << "\t" << start << "\t" << end << "\n";
+                        char * child_qual = (qual != NULL) ? qual + start : NULL;
+                        if (shard_writer != NULL)
+                            shard_writer->write(child_read->m_name.c_str(), comment, seq->seq.s + start,
+                                                child_qual, length);
+                        else
+                            writer.write(child_read->m_name.c_str(), comment, seq->seq.s + start,
+                                         child_qual, length);
                     }
                 }
             }
@@ -311,10 +640,17 @@ int main(int argc, char **argv)
     }
     kseq_destroy(seq);
     gzclose(fp);
+    if (shard_writer != NULL) {
+        bool shards_written = shard_writer->close();
+        delete shard_writer;
+        if (!shards_written)
+            return 1;
+    }
 
     // Clean up.
     for (auto read : reads)
         delete read;
+    delete indexed_input;
 
     std::cerr << "\n";
     return 0;
@@ -19,6 +19,8 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <string.h>
+#include <stdlib.h>
 
 
 std::string double_to_string(double n) {
@@ -47,3 +49,38 @@ void print_hash_progress(std::string filename, long long base_count) {
 void print_read_score_progress(int read_count, long long base_count) {
     std::cerr << "\r  " << int_to_string(read_count) << " reads (" << int_to_string(base_count) << " bp)";
 }
+
+
+
+// Looks for a basecaller-reported mean qscore in a read's header comment. Two forms are recognised: a SAM-style tag
+// (qs:f:12.3 or qs:i:12, as written by Dorado) and Guppy's mean_qscore_template=12.3. Returns false if neither is
+// present or the value can't be parsed.
+bool parse_header_qscore(const char * comment, double & qscore) {
+    if (comment == NULL)
+        return false;
+    const char * value = NULL;
+    for (const char * p = comment; *p != '\0'; ++p) {
+        bool token_start = (p == comment || *p == ' ' || *p == '\t');
+        if (!token_start)
+            continue;
+        const char * token = (p == comment) ? p : p + 1;
+        if (strncmp(token, "qs:", 3) == 0) {
+            value = token + 3;
+            if ((value[0] == 'f' || value[0] == 'i') && value[1] == ':')
+                value += 2;
+            break;
+        }
+        if (strncmp(token, "mean_qscore_template=", 21) == 0) {
+            value = token + 21;
+            break;
+        }
+    }
+    if (value == NULL)
+        return false;
+    char * end;
+    double parsed = strtod(value, &end);
+    if (end == value || parsed < 0.0)
+        return false;
+    qscore = parsed;
+    return true;
+}
@@ -22,6 +22,7 @@ std::string double_to_string(double n);
 std::string int_to_string(long long n);
 void print_hash_progress(std::string filename, long long base_count);
 void print_read_score_progress(int read_count, long long base_count);
+bool parse_header_qscore(const char * comment, double & qscore);
 
 
 #endif // MISC_H
@@ -16,30 +16,89 @@
 
 #include <iostream>
 #include <math.h>
+#include <cstdlib>
 #include <limits>
 #include <string>
+#include <algorithm>
 
 #include "read.h"
 #include "misc.h"
 
-Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kmers, Arguments * args) {
-    m_name = name;
-    m_length = length;
+Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kmers, Kmers * exclude_kmers,
+           Arguments * args, double header_qscore) {
+    initialise(name, length);
 
-    m_first_base_in_kmer = -1;
-    m_last_base_in_kmer = -1;
+    long long exclude_hits = 0;
+    bool exclusion_scanned = false;
+
+    long long source_hits[MAX_REFERENCE_SOURCES] = {0};
+    long long source_positions = 0;
 
     std::vector<double> qualities;
 
+    // For depth-aware selection, the hits' reference regions are collected along with their positions in the read.
+    bool track_regions = kmers->tracking_regions();
+    std::vector<RegionHit> region_hits;
+    RegionHit region_hit;
+
+    // If the basecaller already put the read's mean qscore in the header (and the user asked us to use it), then we
+    // can skip the per-base conversion entirely. This is only allowed when window quality isn't needed, so the window
+    // quality is just set to the mean quality.
+    bool use_header_qscore = args->header_qscore && header_qscore >= 0.0;
+    if (use_header_qscore) {
+        m_mean_quality = header_qscore_to_quality(header_qscore);
+        m_window_quality = m_mean_quality;
+    }
+
+    // Very long reads can have their qualities estimated from a sample of their bases.
+    else if (kmers->empty() && args->approx_length_set && length >= args->approx_length) {
+        set_approximate_qualities(qscores, args->approx_stride, args->window_size,
+                                  args->min_window_q_set ? args->min_window_q : -1.0);
+    }
+
     // If reference k-mers aren't available, use the qscores to get the qualities.
-    if (kmers->empty()) {
+    else if (kmers->empty()) {
         qualities.reserve(length);
         for (int i = 0; i < length; ++i)
             qualities.push_back(qscore_to_quality(qscores[i]));
     }
 
+    // If the reference was indexed by minimizers, then only the read's minimizers are looked up. Coverage is inferred
+    // from the hits: a hit covers its own 16 bases, and two hits from consecutive minimizers (which are never more
+    // than a window apart) cover all bases between them too.
+    else if (kmers->using_minimizers()) {
+        qualities.resize(length, 0.0);
+        MinimizerScanner minimizers(kmers, seq, length);
+        int pos;
+        uint32_t minimizer;
+        bool previous_hit = false;
+        int previous_pos = 0;
+        while (minimizers.next(pos, minimizer)) {
+            ++source_positions;
+            uint8_t sources = kmers->get_kmer_sources(minimizer);
+            if (sources != 0)
+                add_source_hits(sources, source_hits);
+            bool hit = (sources & kmers->score_sources()) != 0;
+            if (hit) {
+                if (track_regions) {
+                    region_hit.position = pos;
+                    region_hit.count = kmers->get_kmer_regions(minimizer, region_hit.first);
+                    if (region_hit.count > 0)
+                        region_hits.push_back(region_hit);
+                }
+                int fill_start = pos;
+                if (previous_hit && pos - previous_pos <= kmers->minimizer_window())
+                    fill_start = previous_pos;
+                for (int j = fill_start; j < pos + 16; ++j)
+                    qualities[j] = 1.0;
+            }
+            previous_hit = hit;
+            previous_pos = pos;
+        }
+    }
+
     // If there are reference k-mers, use them for the qualities. A base is considered to have a quality of 1 if it
-    // is in any present 16-mer, 0 if it is not.
+    // is in any present 16-mer (only counting the --score_reference's 16-mers, if one was chosen), 0 if it is not.
     else {
         qualities.resize(length, 0.0);
         if (length >= 16) {
@@ -49,21 +108,95 @@ Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kme
                     kmer <<= 2;
                     kmer |= kmers->base_to_bits_forward(seq[i]);
                 }
-                if (kmers->is_kmer_present(kmer)) {
+                uint8_t sources = kmers->get_kmer_sources(kmer);
+                if (sources != 0)
+                    add_source_hits(sources, source_hits);
+                if (sources & kmers->score_sources()) {
                     for (int j = i - 15; j <= i; ++j)
                         qualities[j] = 1.0;
+                    if (track_regions) {
+                        region_hit.position = i - 15;
+                        region_hit.count = kmers->get_kmer_regions(kmer, region_hit.first);
+                        if (region_hit.count > 0)
+                            region_hits.push_back(region_hit);
+                    }
                 }
+                if (exclude_kmers != NULL && exclude_kmers->is_kmer_present(kmer))
+                    ++exclude_hits;
             }
         }
+        exclusion_scanned = true;
+        source_positions = std::max(length - 15, 0);
     }
 
-    m_mean_quality = get_mean_quality(qualities);
-    m_window_quality = get_window_quality(qualities, args->window_size);
+    // With more than one reference, record what fraction of the read's k-mers (or minimizers) each one had.
+    if (kmers->source_count() > 1 && !kmers->empty()) {
+        m_source_fractions.resize(kmers->source_count(), 0.0);
+        if (source_positions > 0) {
+            for (int i = 0; i < kmers->source_count(); ++i)
+                m_source_fractions[i] = double(source_hits[i]) / source_positions;
+        }
+    }
+
+    // If there's an exclusion set (e.g. a host genome) and it wasn't already checked in the k-mer scan above, then
+    // the read gets a scan of its own. Reads with too many exclusion k-mers fail.
+    if (exclude_kmers != NULL && length >= 16) {
+        if (!exclusion_scanned)
+            exclude_hits = count_present_kmers(seq, length, exclude_kmers);
+        m_exclude_fraction = double(exclude_hits) / (length - 15);
+        m_excluded = m_exclude_fraction > args->exclude_fraction;
+    }
+
+    // If k-mer coverage is being saved for later runs, store it as a list of covered ranges.
+    if (args->save_coverage_set && !kmers->empty())
+        m_covered_ranges = get_covered_ranges(qualities);
+
+    set_scores(qualities, !kmers->empty(), use_header_qscore || m_approximate, args);
+    if (track_regions)
+        set_regions(kmers, region_hits);
+}
+
+
+// This constructor makes a read from previously saved k-mer coverage (1 for covered bases, 0 for others), so it
+// can be scored without the sequence or the reference. It's also used for the children of trimmed/split reads.
+Read::Read(std::string name, std::vector<double> & coverage, Arguments * args) {
+    initialise(name, int(coverage.size()));
+    set_scores(coverage, true, false, args);
+}
+
+
+void Read::initialise(std::string name, int length) {
+    m_name = name;
+    m_length = length;
+
+    m_first_base_in_kmer = -1;
+    m_last_base_in_kmer = -1;
+
+    m_approximate = false;
+    m_mean_quality_error = 0.0;
+    m_window_quality_error = 0.0;
+
+    m_excluded = false;
+    m_exclude_fraction = 0.0;
+}
+
+
+// Sets the read's scores and pass/fail status from its per-base qualities. If the qualities come from k-mer
+// coverage, this also trims/splits the read (as needed) and makes its child reads.
+void Read::set_scores(std::vector<double> & qualities, bool kmer_based, bool mean_quality_already_set,
+                      Arguments * args) {
+    int length = m_length;
+    if (!mean_quality_already_set) {
+        m_mean_quality = get_mean_quality(qualities);
+        m_window_quality = get_window_quality(qualities, args->window_size);
+    }
     m_length_score = get_length_score();
 
     // See if the read failed any of the hard cut-offs.
     m_passed = true;
-    if (args->min_length_set && m_length < args->min_length)
+    if (m_excluded)
+        m_passed = false;
+    else if (args->min_length_set && m_length < args->min_length)
         m_passed = false;
     else if (args->min_mean_q_set && m_mean_quality < args->min_mean_q)
         m_passed = false;
@@ -72,7 +205,7 @@ Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kme
 
     m_first_base_in_kmer = -1;
     m_last_base_in_kmer = -1;
-    if (!kmers->empty()) {
+    if (kmer_based) {
         for (int i = 0; i < length; ++i) {
             if (qualities[i] != 0) {
                 if (m_first_base_in_kmer == -1)
@@ -114,6 +247,9 @@ Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kme
                 }
             }
 
+            // The child reads are scored from their slice of this read's k-mer coverage. Since the child ranges
+            // start and end next to uncovered bases, no k-mer hit crosses a child's boundary, so this gives the same
+            // result as rescanning the child's sequence.
             if (m_bad_ranges.size() > 0) {
                 int range_start = 0;
                 int range_end;
@@ -132,8 +268,11 @@ Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kme
                     int child_end = child_start + child_length;
                     std::string child_name = m_name + "_" +
                             std::to_string(child_start+1) + "-" + std::to_string(child_end);
-                    Read * child = new Read(child_name, seq + child_start, qscores + child_start, child_length,
-                                            kmers, args);
+                    std::vector<double> child_qualities(qualities.begin() + child_start,
+                                                        qualities.begin() + child_end);
+                    Read * child = new Read(child_name, child_qualities, args);
+                    if (m_excluded)
+                        child->m_passed = false;
                     m_child_reads.push_back(child);
                 }
             }
@@ -142,6 +281,100 @@ Read::Read(std::string name, char * seq, char * qscores, int length, Kmers * kme
 }
 
 
+// Sets this read's region placements (and its children's, from the hits within their ranges).
+void Read::set_regions(Kmers * kmers, std::vector<RegionHit> & region_hits) {
+    m_region_placements = place_regions(kmers, region_hits, 0, m_length);
+    for (size_t i = 0; i < m_child_reads.size(); ++i)
+        m_child_reads[i]->m_region_placements = place_regions(kmers, region_hits, m_child_read_ranges[i].first,
+                                                              m_child_read_ranges[i].second);
+}
+
+
+// Hits in only one region anchor a read to its place on the reference, and its repeat hits are then placed relative
+// to those anchors. A read with no anchors is entirely in a repeat, so each copy of its first hit gives a placement.
+std::vector<std::vector<uint32_t> > Read::place_regions(Kmers * kmers, std::vector<RegionHit> & region_hits,
+                                                        int start, int end) {
+    std::vector<std::vector<uint32_t> > placements;
+    std::vector<std::pair<int, uint32_t> > anchors;
+    RegionHit * first_repeat_hit = NULL;
+    for (auto & hit : region_hits) {
+        if (hit.position < start || hit.position >= end)
+            continue;
+        if (hit.count == 1)
+            anchors.push_back(std::pair<int, uint32_t>(hit.position, kmers->region_at(hit.first)));
+        else if (first_repeat_hit == NULL)
+            first_repeat_hit = &hit;
+    }
+    if (!anchors.empty())
+        placements.push_back(place_hits(kmers, region_hits, start, end, anchors));
+    else if (first_repeat_hit != NULL) {
+        for (int i = 0; i < first_repeat_hit->count; ++i) {
+            std::vector<std::pair<int, uint32_t> > copy_anchor;
+            copy_anchor.push_back(std::pair<int, uint32_t>(first_repeat_hit->position,
+                                                           kmers->region_at(first_repeat_hit->first + i)));
+            placements.push_back(place_hits(kmers, region_hits, start, end, copy_anchor));
+        }
+    }
+    return placements;
+}
+
+
+// Gives the anchors' regions plus, for each repeat hit, whichever of its regions is closest to the nearest anchor (in
+// read position). A repeat hit is left out if none of its regions is close enough to that anchor to be the same copy.
+// The result is sorted without duplicates.
+std::vector<uint32_t> Read::place_hits(Kmers * kmers, std::vector<RegionHit> & region_hits, int start, int end,
+                                       std::vector<std::pair<int, uint32_t> > & anchors) {
+    std::vector<uint32_t> regions;
+    for (auto & anchor : anchors)
+        regions.push_back(anchor.second);
+
+    // Hits and anchors are both in read position order, so the nearest anchor only ever moves forward.
+    size_t nearest = 0;
+    for (auto & hit : region_hits) {
+        if (hit.position < start || hit.position >= end || hit.count == 1)
+            continue;
+        while (nearest + 1 < anchors.size() &&
+               std::abs(anchors[nearest + 1].first - hit.position) <= std::abs(anchors[nearest].first - hit.position))
+            ++nearest;
+        long long anchor_region = anchors[nearest].second;
+        long long max_distance = std::abs(anchors[nearest].first - hit.position) / DEPTH_REGION_SIZE + 1;
+        long long best_distance = max_distance + 1;
+        uint32_t best_region = 0;
+        for (int i = 0; i < hit.count; ++i) {
+            uint32_t region = kmers->region_at(hit.first + i);
+            long long distance = std::abs(region - anchor_region);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best_region = region;
+            }
+        }
+        if (best_distance <= max_distance)
+            regions.push_back(best_region);
+    }
+    std::sort(regions.begin(), regions.end());
+    regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+    return regions;
+}
+
+// Converts 0/1 k-mer coverage into a list of covered (start, end) ranges.
+std::vector<std::pair<int,int> > Read::get_covered_ranges(std::vector<double> & qualities) {
+    std::vector<std::pair<int,int> > ranges;
+    int i = 0;
+    int length = int(qualities.size());
+    while (i < length) {
+        if (qualities[i] != 0.0) {
+            int start = i;
+            while (i < length && qualities[i] != 0.0)
+                ++i;
+            ranges.push_back(std::pair<int,int>(start, i));
+        }
+        else
+            ++i;
+    }
+    return ranges;
+}
+
+
 Read::~Read() {
     for (auto child : m_child_reads)
         delete child;
@@ -170,6 +403,21 @@ void Read::print_verbose_read_info() {
     std::cerr << "            length = " << pad(m_length, 11);
     std::cerr << "mean quality = " << double_to_string(m_mean_quality);
     std::cerr << "      window quality = " << double_to_string(m_window_quality) << "\n";
+    if (m_excluded)
+        std::cerr << "          excluded = " << double_to_string(100.0 * m_exclude_fraction)
+                  << "% of 16-mers in exclusion assembly\n";
+    if (!m_source_fractions.empty()) {
+        std::cerr << "    reference hits = ";
+        for (size_t i = 0; i < m_source_fractions.size(); ++i) {
+            std::cerr << double_to_string(100.0 * m_source_fractions[i]) << "%";
+            if (i < m_source_fractions.size() - 1)
+                std::cerr << ", ";
+        }
+        std::cerr << "\n";
+    }
+    if (m_approximate)
+        std::cerr << "mean quality error = " << double_to_string(m_mean_quality_error)
+                  << "      window quality error = " << double_to_string(m_window_quality_error) << "\n";
 
     if (m_bad_ranges.size() > 0) {
         std::cerr << "        bad ranges = ";
@@ -233,6 +481,133 @@ double Read::get_window_quality(std::vector<double> & qualities, size_t window_s
     return 100.0 * min_window_quality;
 }
 
+
+// This estimates the mean and window qualities using every stride-th base instead of all of them. The mean quality
+// comes with a 95% error bound (stored in m_mean_quality_error). For window quality, window means are first estimated
+// from the sampled bases and then the lowest few candidate windows are recomputed exactly from the full qscores. If a
+// window quality threshold is given (-1 if not), every window whose estimate is within the margin of it is also
+// recomputed, so reads near the threshold pass or fail on exact windows. m_window_quality_error is a 95% bound on how
+// far the true minimum could be below the reported one.
+void Read::set_approximate_qualities(char * qscores, int stride, int window_size, double window_threshold) {
+    m_approximate = true;
+
+    std::vector<double> samples;
+    samples.reserve(m_length / stride + 1);
+    for (int i = 0; i < m_length; i += stride)
+        samples.push_back(qscore_to_quality(qscores[i]));
+    size_t n = samples.size();
+
+    double sum = 0.0;
+    for (auto q : samples)
+        sum += q;
+    double mean = sum / n;
+    double squared_diff_sum = 0.0;
+    for (auto q : samples)
+        squared_diff_sum += (q - mean) * (q - mean);
+    double sample_stdev = (n > 1) ? sqrt(squared_diff_sum / (n - 1)) : 0.0;
+    double finite_population_correction = sqrt(1.0 - double(n) / m_length);
+    m_mean_quality = 100.0 * mean;
+    m_mean_quality_error = 100.0 * 1.96 * sample_stdev / sqrt(double(n)) * finite_population_correction;
+
+    if (m_length <= window_size) {
+        m_window_quality = m_mean_quality;
+        m_window_quality_error = m_mean_quality_error;
+        return;
+    }
+
+    // Coarse pass: a sliding window over the samples, where sampled window k starts at base k * stride.
+    size_t samples_per_window = std::max(size_t(1), size_t(window_size / stride));
+    size_t coarse_window_count = size_t((m_length - window_size) / stride) + 1;
+    coarse_window_count = std::min(coarse_window_count, n - std::min(n, samples_per_window - 1));
+    if (coarse_window_count == 0) {
+        m_window_quality = m_mean_quality;
+        m_window_quality_error = m_mean_quality_error;
+        return;
+    }
+    std::vector<std::pair<double, int> > coarse_windows;
+    coarse_windows.reserve(coarse_window_count);
+    double window_sum = 0.0;
+    for (size_t i = 0; i < samples_per_window; ++i)
+        window_sum += samples[i];
+    coarse_windows.push_back(std::pair<double, int>(window_sum / samples_per_window, 0));
+    for (size_t k = 1; k < coarse_window_count; ++k) {
+        window_sum += samples[k + samples_per_window - 1] - samples[k - 1];
+        coarse_windows.push_back(std::pair<double, int>(window_sum / samples_per_window, int(k)));
+    }
+
+    // Refinement pass: windows whose estimate is close to the coarse minimum are recomputed exactly (including the
+    // start positions between samples), up to a fixed number of candidates. Then, if the minimum so far isn't already
+    // below the threshold, so is every window whose estimate is close to the threshold, stopping at the first one below.
+    double margin = 1.96 * sample_stdev / sqrt(double(samples_per_window));
+    size_t max_candidates = 16;
+    double threshold = window_threshold / 100.0;
+    std::sort(coarse_windows.begin(), coarse_windows.end());
+    double coarse_min = coarse_windows.front().first;
+    double min_window_quality = std::numeric_limits<double>::max();
+    size_t refined = 0;
+    for (; refined < coarse_windows.size(); ++refined) {
+        double estimate = coarse_windows[refined].first;
+        bool near_minimum = (refined < max_candidates && estimate <= coarse_min + margin);
+        bool near_threshold = (window_threshold >= 0.0 && min_window_quality >= threshold &&
+                               estimate < threshold + margin);
+        if (!near_minimum && !near_threshold)
+            break;
+        int start = coarse_windows[refined].second * stride;
+        int first_start = std::max(0, start - stride + 1);
+        int last_start = std::min(m_length - window_size, start + stride - 1);
+        double exact = get_exact_window_minimum(qscores, first_start, last_start, window_size);
+        min_window_quality = std::min(min_window_quality, exact);
+    }
+
+    // Windows which weren't recomputed are (with 95% confidence) no lower than their estimate minus the margin.
+    double lower_bound = min_window_quality;
+    if (refined < coarse_windows.size())
+        lower_bound = std::min(lower_bound, coarse_windows[refined].first - margin);
+    if (min_window_quality < 0.5 / window_size)
+        min_window_quality = 0.0;
+    m_window_quality = 100.0 * min_window_quality;
+    m_window_quality_error = 100.0 * std::max(0.0, min_window_quality - std::max(0.0, lower_bound));
+}
+
+
+// Returns the lowest mean quality of all windows starting from first_start to last_start (inclusive).
+double Read::get_exact_window_minimum(char * qscores, int first_start, int last_start, int window_size) {
+    double sum = 0.0;
+    for (int i = first_start; i < first_start + window_size; ++i)
+        sum += qscore_to_quality(qscores[i]);
+    double min_sum = sum;
+    for (int start = first_start + 1; start <= last_start; ++start) {
+        sum -= qscore_to_quality(qscores[start - 1]);
+        sum += qscore_to_quality(qscores[start + window_size - 1]);
+        min_sum = std::min(min_sum, sum);
+    }
+    return min_sum / window_size;
+}
+
+
+void Read::add_source_hits(uint8_t sources, long long * source_hits) {
+    for (int i = 0; i < MAX_REFERENCE_SOURCES; ++i) {
+        if (sources & (1 << i))
+            ++source_hits[i];
+    }
+}
+
+
+long long Read::count_present_kmers(char * seq, int length, Kmers * kmers) {
+    long long count = 0;
+    uint32_t kmer = kmers->starting_kmer_to_bits_forward(seq);
+    for (int i = 15; i < length; ++i) {
+        if (i > 15) {
+            kmer <<= 2;
+            kmer |= kmers->base_to_bits_forward(seq[i]);
+        }
+        if (kmers->is_kmer_present(kmer))
+            ++count;
+    }
+    return count;
+}
+
+
 // At the moment, the half-score length is hard-coded to 5 kbp. Maybe this should be adjustable via a setting?
 // https://www.desmos.com/calculator
 // y=100\left(1+\frac{-a}{x+a}\right)
@@ -269,3 +644,22 @@ double Read::qscore_to_quality(char qscore) {
     int q = qscore - 33;
     return 1.0 - pow(10.0, -q / 10.0);
 }
+
+
+// Basecallers report a read's mean qscore as the Phred-scaled mean error probability, so this converts it to the same
+// scale as get_mean_quality (the mean per-base probability of being correct, as a percentage).
+double Read::header_qscore_to_quality(double header_qscore) {
+    return 100.0 * (1.0 - pow(10.0, -header_qscore / 10.0));
+}
+
+
+// This computes the mean quality from the per-base qscores, even if the read was scored using its header qscore. It's
+// used to spot-check header values against the actual qualities.
+double Read::get_qscore_mean_quality(char * qscores) {
+    if (m_length == 0)
+        return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < m_length; ++i)
+        sum += qscore_to_quality(qscores[i]);
+    return 100.0 * sum / m_length;
+}
@@ -26,10 +26,21 @@
 #include "arguments.h"
 
 
+// A reference k-mer hit in a read, for depth-aware selection: its position in the read and its regions (first is an
+// index for Kmers::region_at, and a repeated k-mer has more than one region).
+struct RegionHit {
+    int position;
+    size_t first;
+    int count;
+};
+
+
 class Read
 {
 public:
-    Read(std::string name, char * seq, char * qscores, int length, Kmers * kmers, Arguments * args);
+    Read(std::string name, char * seq, char * qscores, int length, Kmers * kmers, Kmers * exclude_kmers,
+         Arguments * args, double header_qscore);
+    Read(std::string name, std::vector<double> & coverage, Arguments * args);
     ~Read();
 
     void print_verbose_read_info();
@@ -37,6 +48,8 @@ public:
 
     void set_final_score(double length_weight, double mean_q_weight, double window_q_weight);
 
+    double get_qscore_mean_quality(char * qscores);
+
     std::string m_name;
 
     int m_length;
@@ -44,10 +57,26 @@ public:
 
     double m_mean_quality;
     double m_window_quality;
+    double m_raw_mean_quality;
+
+    bool m_approximate;
+    double m_mean_quality_error;
+    double m_window_quality_error;
 
     double m_final_score;
     bool m_passed;
 
+    bool m_excluded;
+    double m_exclude_fraction;
+
+    std::vector<double> m_source_fractions;
+
+    std::vector<std::pair<int,int> > m_covered_ranges;
+
+    // The reference regions (see DEPTH_REGION_SIZE) this read covers, only set for depth-aware selection. A read
+    // entirely in a repeat has one placement for each copy of the repeat, otherwise there's just one.
+    std::vector<std::vector<uint32_t> > m_region_placements;
+
     int m_first_base_in_kmer;
     int m_last_base_in_kmer;
     std::vector<std::pair<int,int> > m_bad_ranges;
@@ -56,12 +85,28 @@ public:
     std::vector<std::pair<int,int> > m_child_read_ranges;
 
 private:
+    void initialise(std::string name, int length);
+    void set_scores(std::vector<double> & qualities, bool kmer_based, bool mean_quality_already_set,
+                    Arguments * args);
+    std::vector<std::pair<int,int> > get_covered_ranges(std::vector<double> & qualities);
+    void set_regions(Kmers * kmers, std::vector<RegionHit> & region_hits);
+    std::vector<std::vector<uint32_t> > place_regions(Kmers * kmers, std::vector<RegionHit> & region_hits,
+                                                      int start, int end);
+    std::vector<uint32_t> place_hits(Kmers * kmers, std::vector<RegionHit> & region_hits, int start, int end,
+                                     std::vector<std::pair<int, uint32_t> > & anchors);
+
     double get_mean_quality(std::vector<double> & qualities);
     double get_window_quality(std::vector<double> & qualities, size_t window_size);
+    void set_approximate_qualities(char * qscores, int stride, int window_size, double window_threshold);
+    double get_exact_window_minimum(char * qscores, int first_start, int last_start, int window_size);
 
     double get_length_score();
 
+    long long count_present_kmers(char * seq, int length, Kmers * kmers);
+    void add_source_hits(uint8_t sources, long long * source_hits);
+
     double qscore_to_quality(char qscore);
+    double header_qscore_to_quality(double header_qscore);
 };
 
 
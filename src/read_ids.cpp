@@ -0,0 +1,126 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "read_ids.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <zlib.h>
+#include <stdio.h>
+#include "kseq.h"
+#include "misc.h"
+
+KSEQ_INIT(gzFile, gzread)
+
+
+ReadIds::ReadIds() {
+    m_whole_read_count = 0;
+    m_range_count = 0;
+}
+
+
+bool ReadIds::load(std::string filename) {
+    std::ifstream ids_file(filename);
+    if (!ids_file.good()) {
+        std::cerr << "Error reading " << filename << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(ids_file, line)) {
+        if (line.empty())
+            continue;
+        size_t tab = line.find('\t');
+        uint64_t name_hash = hash_name(line.c_str(), std::min(tab, line.size()));
+        if (tab == std::string::npos) {
+            m_whole_reads.insert(name_hash);
+            ++m_whole_read_count;
+        }
+        else {
+            std::istringstream range(line.substr(tab + 1));
+            int start, end;
+            if (!(range >> start >> end) || start < 0 || end < start) {
+                std::cerr << "Error: bad read ID line in " << filename << ": " << line << "\n";
+                return false;
+            }
+            m_read_ranges[name_hash].push_back(std::pair<int,int>(start, end));
+            ++m_range_count;
+        }
+    }
+    return true;
+}
+
+
+// Reads through the given reads, outputting those in the set. Reads with ranges are output as one record
+// per range, named the same way Filtlong names trimmed/split reads.
+int ReadIds::apply_to_reads(std::string filename, ReadWriter & writer) {
+    long long output_count = 0;
+    long long output_bases = 0;
+    int l;
+    gzFile fp = gzopen(filename.c_str(), "r");
+    kseq_t * seq = kseq_init(fp);
+    while ((l = kseq_read(seq)) >= 0) {
+        char * qual = (seq->qual.l > 0) ? seq->qual.s : NULL;
+        char * comment = (seq->comment.l > 0) ? seq->comment.s : NULL;
+        uint64_t name_hash = hash_name(seq->name.s, seq->name.l);
+
+        if (m_whole_reads.find(name_hash) != m_whole_reads.end()) {
+            writer.write(seq->name.s, comment, seq->seq.s, qual, int(seq->seq.l));
+            ++output_count;
+            output_bases += seq->seq.l;
+        }
+
+        auto ranges = m_read_ranges.find(name_hash);
+        if (ranges == m_read_ranges.end())
+            continue;
+        for (auto range : ranges->second) {
+            int start = range.first;
+            int end = std::min(range.second, int(seq->seq.l));
+            if (end - start <= 0)
+                continue;
+            std::string child_name = std::string(seq->name.s) + "_" +
+                    std::to_string(start + 1) + "-" + std::to_string(end);
+            writer.write(child_name.c_str(), comment, seq->seq.s + start,
+                         (qual != NULL) ? qual + start : NULL, end - start);
+            ++output_count;
+            output_bases += end - start;
+        }
+    }
+    kseq_destroy(seq);
+    gzclose(fp);
+    if (l == -2) {
+        std::cerr << "Error: incorrect FASTQ format in " << filename << "\n";
+        return 1;
+    }
+    if (l == -3) {
+        std::cerr << "Error reading " << filename << "\n";
+        return 1;
+    }
+    std::cerr << "  " << int_to_string(output_count) << " reads (" << int_to_string(output_bases) << " bp)\n";
+    return 0;
+}
+
+
+// 64-bit FNV-1a hash of a read name.
+uint64_t ReadIds::hash_name(const char * name, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= uint64_t((unsigned char)name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,52 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef READ_IDS_H
+#define READ_IDS_H
+
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <utility>
+#include <stdint.h>
+
+#include "read_writer.h"
+
+
+// A set of kept read IDs, as written by --write_ids. Each line of the file is either a read name (the whole read was
+// kept) or a read name followed by a tab-delimited 0-based start and end (that part of the read was kept after
+// trimming/splitting). Names are stored as 64-bit hashes to keep the set compact.
+class ReadIds
+{
+public:
+    ReadIds();
+
+    bool load(std::string filename);
+    int apply_to_reads(std::string filename, ReadWriter & writer);
+
+    long long m_whole_read_count;
+    long long m_range_count;
+
+private:
+    std::unordered_set<uint64_t> m_whole_reads;
+    std::unordered_map<uint64_t, std::vector<std::pair<int,int> > > m_read_ranges;
+
+    uint64_t hash_name(const char * name, size_t length);
+};
+
+
+#endif // READ_IDS_H
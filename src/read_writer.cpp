@@ -0,0 +1,63 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "read_writer.h"
+
+
+ReadWriter::ReadWriter(Arguments * args, std::ostream * out) {
+    m_out = out;
+    m_fasta_output = args->fasta_output;
+    m_bin_qualities = !args->qual_bins.empty();
+
+    // Quality binning uses a lookup table: each qscore is replaced by the largest bin value not above it (or the
+    // smallest bin value if it's below all of them).
+    for (int i = 0; i < 256; ++i)
+        m_qual_table[i] = char(i);
+    if (m_bin_qualities) {
+        for (int q = 0; q < 256 - 33; ++q) {
+            int binned = args->qual_bins.front();
+            for (auto bin : args->qual_bins) {
+                if (bin <= q)
+                    binned = bin;
+            }
+            m_qual_table[q + 33] = char(binned + 33);
+        }
+    }
+}
+
+
+// Writes one read. If qual is NULL (or FASTA output was requested), the read is written in FASTA format.
+void ReadWriter::write(const char * name, const char * comment, const char * seq, const char * qual, int length) {
+    bool fastq = (qual != NULL && !m_fasta_output);
+    *m_out << (fastq ? "@" : ">") << name;
+    if (comment != NULL && comment[0] != '\0')
+        *m_out << " " << comment;
+    *m_out << "\n";
+    m_out->write(seq, length);
+    *m_out << "\n";
+    if (fastq) {
+        *m_out << "+\n";
+        if (m_bin_qualities) {
+            m_qual_buffer.resize(length);
+            for (int i = 0; i < length; ++i)
+                m_qual_buffer[i] = m_qual_table[(unsigned char)qual[i]];
+            m_out->write(m_qual_buffer.data(), length);
+        }
+        else
+            m_out->write(qual, length);
+        *m_out << "\n";
+    }
+}
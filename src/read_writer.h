@@ -0,0 +1,45 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef READ_WRITER_H
+#define READ_WRITER_H
+
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "arguments.h"
+
+
+// Writes output reads, applying any output transforms (quality binning, FASTA conversion) on the way out. These only
+// affect what is written: scoring always uses the full-resolution qualities.
+class ReadWriter
+{
+public:
+    ReadWriter(Arguments * args, std::ostream * out);
+
+    void write(const char * name, const char * comment, const char * seq, const char * qual, int length);
+
+private:
+    std::ostream * m_out;
+    bool m_fasta_output;
+    bool m_bin_qualities;
+    char m_qual_table[256];
+    std::string m_qual_buffer;
+};
+
+
+#endif // READ_WRITER_H
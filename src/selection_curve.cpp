@@ -0,0 +1,84 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "selection_curve.h"
+
+#include <iostream>
+#include <fstream>
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+
+bool write_selection_curve(std::string filename, std::vector<Read*> reads, long long total_bases) {
+    std::ofstream curve(filename);
+    if (!curve.good()) {
+        std::cerr << "Error: could not write to " << filename << "\n";
+        return false;
+    }
+    curve << "score_threshold\treads\tbases\tpercent_bases\tmean_quality\tn50\n";
+
+    // Only reads which passed the hard thresholds can be kept, so they're the only ones on the curve.
+    std::vector<Read*> passed;
+    for (auto read : reads) {
+        if (read->m_passed)
+            passed.push_back(read);
+    }
+    std::stable_sort(passed.begin(), passed.end(),
+                     [](const Read* a, const Read* b) {return a->m_final_score > b->m_final_score;});
+
+    // The N50 is tracked with two heaps: 'top' holds the smallest set of longest reads making up at least half of the
+    // bases (so its smallest read is the N50) and 'rest' holds everything else.
+    std::priority_queue<int, std::vector<int>, std::greater<int> > top;
+    std::priority_queue<int> rest;
+    long long top_bases = 0;
+
+    long long read_count = 0;
+    long long bases = 0;
+    double quality_sum = 0.0;
+    for (size_t i = 0; i < passed.size(); ++i) {
+        Read * read = passed[i];
+        ++read_count;
+        bases += read->m_length;
+        quality_sum += read->m_raw_mean_quality * read->m_length;
+
+        if (!top.empty() && read->m_length < top.top())
+            rest.push(read->m_length);
+        else {
+            top.push(read->m_length);
+            top_bases += read->m_length;
+        }
+        while (!rest.empty() && 2 * top_bases < bases) {
+            top.push(rest.top());
+            top_bases += rest.top();
+            rest.pop();
+        }
+        while (!top.empty() && 2 * (top_bases - top.top()) >= bases) {
+            top_bases -= top.top();
+            rest.push(top.top());
+            top.pop();
+        }
+
+        // Reads with tied scores are all kept or all lost together, so only write a row after the last of them.
+        if (i + 1 < passed.size() && passed[i + 1]->m_final_score == read->m_final_score)
+            continue;
+        double percent_bases = (total_bases > 0) ? 100.0 * bases / total_bases : 0.0;
+        double mean_quality = (bases > 0) ? quality_sum / bases : 0.0;
+        curve << read->m_final_score << "\t" << read_count << "\t" << bases << "\t" << percent_bases << "\t"
+              << mean_quality << "\t" << (top.empty() ? 0 : top.top()) << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef SELECTION_CURVE_H
+#define SELECTION_CURVE_H
+
+
+#include <string>
+#include <vector>
+
+#include "read.h"
+
+
+// Writes a table of what would be kept at every final score threshold: the number of reads and bases, the percentage
+// of input bases, the base-weighted mean quality and the N50. It's made in one pass over the reads sorted by score, so
+// a single scoring run can answer any --target_bases/--keep_percent question.
+bool write_selection_curve(std::string filename, std::vector<Read*> reads, long long total_bases);
+
+
+#endif // SELECTION_CURVE_H
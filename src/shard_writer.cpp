@@ -0,0 +1,171 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "shard_writer.h"
+
+#include <iostream>
+#include "misc.h"
+
+
+// Buffers are handed to the compression thread at about this size, and at most a few can be waiting at once.
+#define SHARD_CHUNK_SIZE 1048576
+#define SHARD_MAX_QUEUED 4
+
+
+ShardWriter::ShardWriter(Arguments * args, std::string extension) {
+    m_args = args;
+    m_prefix = args->shard_output;
+    m_extension = extension;
+    m_shard_count = args->shards;
+    m_by_bases = args->shard_by_bases;
+    m_max_bases = args->shard_max_bases_set ? args->shard_max_bases : 0;
+    m_next_shard = 0;
+    m_failed = false;
+}
+
+
+ShardWriter::~ShardWriter() {
+    for (auto shard : m_shards) {
+        if (shard->thread.joinable())
+            close_shard(shard);
+        delete shard->writer;
+        delete shard;
+    }
+}
+
+
+// With a fixed number of shards, they're all opened up front (so there are always that many files). With a size
+// limit, they're opened as needed.
+bool ShardWriter::open() {
+    int count = (m_max_bases > 0) ? 1 : m_shard_count;
+    for (int i = 0; i < count; ++i) {
+        if (!open_shard())
+            return false;
+    }
+    return true;
+}
+
+
+bool ShardWriter::open_shard() {
+    Shard * shard = new Shard;
+    m_shards.push_back(shard);
+    shard->filename = m_prefix + "_" + std::to_string(m_shards.size()) + m_extension;
+    shard->writer = new ReadWriter(m_args, &shard->buffer);
+    shard->records = 0;
+    shard->bases = 0;
+    shard->finished = false;
+    shard->failed = false;
+    shard->fp = gzopen(shard->filename.c_str(), "wb");
+    if (shard->fp == NULL) {
+        std::cerr << "Error: could not write to " << shard->filename << "\n";
+        return false;
+    }
+    shard->thread = std::thread(compress, shard);
+    return true;
+}
+
+
+void ShardWriter::compress(Shard * shard) {
+    while (true) {
+        std::string chunk;
+        {
+            std::unique_lock<std::mutex> lock(shard->mutex);
+            shard->changed.wait(lock, [shard] {return !shard->queue.empty() || shard->finished;});
+            if (shard->queue.empty())
+                return;
+            chunk.swap(shard->queue.front());
+            shard->queue.pop_front();
+        }
+        shard->changed.notify_all();
+        if (gzwrite(shard->fp, chunk.data(), unsigned(chunk.size())) != int(chunk.size()))
+            shard->failed = true;
+    }
+}
+
+
+void ShardWriter::hand_off(Shard * shard) {
+    std::string chunk = shard->buffer.str();
+    shard->buffer.str("");
+    if (chunk.empty() || !shard->thread.joinable())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->changed.wait(lock, [shard] {return shard->queue.size() < SHARD_MAX_QUEUED;});
+        shard->queue.push_back(std::string());
+        shard->queue.back().swap(chunk);
+    }
+    shard->changed.notify_all();
+}
+
+
+bool ShardWriter::close_shard(Shard * shard) {
+    hand_off(shard);
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->finished = true;
+    }
+    shard->changed.notify_all();
+    shard->thread.join();
+    bool good = !shard->failed && gzclose(shard->fp) == Z_OK;
+    if (!good)
+        std::cerr << "Error: could not write to " << shard->filename << "\n";
+    return good;
+}
+
+
+Shard * ShardWriter::choose_shard(int length) {
+    if (m_max_bases > 0) {
+        Shard * current = m_shards.back();
+        if (current->bases > 0 && current->bases + length > m_max_bases) {
+            m_failed = !close_shard(current) || m_failed;
+            m_failed = !open_shard() || m_failed;
+        }
+        return m_shards.back();
+    }
+    if (m_by_bases) {
+        Shard * smallest = m_shards.front();
+        for (auto shard : m_shards) {
+            if (shard->bases < smallest->bases)
+                smallest = shard;
+        }
+        return smallest;
+    }
+    Shard * shard = m_shards[m_next_shard];
+    m_next_shard = (m_next_shard + 1) % m_shards.size();
+    return shard;
+}
+
+
+void ShardWriter::write(const char * name, const char * comment, const char * seq, const char * qual, int length) {
+    Shard * shard = choose_shard(length);
+    shard->writer->write(name, comment, seq, qual, length);
+    ++shard->records;
+    shard->bases += length;
+    if (shard->buffer.tellp() >= SHARD_CHUNK_SIZE)
+        hand_off(shard);
+}
+
+
+bool ShardWriter::close() {
+    bool good = !m_failed;
+    for (auto shard : m_shards) {
+        if (shard->thread.joinable())
+            good = close_shard(shard) && good;
+        std::cerr << "  " << shard->filename << ": " << int_to_string(shard->records) << " reads, "
+                  << int_to_string(shard->bases) << " bp\n";
+    }
+    return good;
+}
@@ -0,0 +1,86 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef SHARD_WRITER_H
+#define SHARD_WRITER_H
+
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+#include "arguments.h"
+#include "read_writer.h"
+
+
+// One gzipped output file. Reads are formatted into an in-memory buffer, and full buffers are handed to the shard's
+// own thread for compression, so the output pass isn't held up by gzip.
+struct Shard
+{
+    std::string filename;
+    gzFile fp;
+    std::ostringstream buffer;
+    ReadWriter * writer;
+    long long records;
+    long long bases;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;
+    bool finished;
+    bool failed;
+};
+
+
+// Writes output reads to a set of shard files (prefix_1.fastq.gz, prefix_2.fastq.gz, etc.) instead of stdout. Reads
+// are assigned round-robin by record, to whichever shard has the fewest bases, or (with a size limit) to one shard
+// until it's full and then the next.
+class ShardWriter
+{
+public:
+    ShardWriter(Arguments * args, std::string extension);
+    ~ShardWriter();
+
+    bool open();
+    void write(const char * name, const char * comment, const char * seq, const char * qual, int length);
+    bool close();
+
+private:
+    Arguments * m_args;
+    std::string m_prefix;
+    std::string m_extension;
+    int m_shard_count;
+    bool m_by_bases;
+    long long m_max_bases;
+
+    std::vector<Shard *> m_shards;
+    size_t m_next_shard;
+    bool m_failed;
+
+    bool open_shard();
+    bool close_shard(Shard * shard);
+    Shard * choose_shard(int length);
+    void hand_off(Shard * shard);
+    static void compress(Shard * shard);
+};
+
+
+#endif // SHARD_WRITER_H
@@ -0,0 +1,201 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "shm_ring.h"
+
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "read.h"
+#include "misc.h"
+
+
+ShmRingReader::ShmRingReader() {
+    m_fd = -1;
+    m_map_size = 0;
+    m_map = NULL;
+    m_data = NULL;
+    m_capacity = 0;
+    m_write_pos = NULL;
+    m_read_pos = NULL;
+    m_closed = NULL;
+    m_position = 0;
+    m_record_end = 0;
+}
+
+
+ShmRingReader::~ShmRingReader() {
+    if (m_map != NULL)
+        munmap(m_map, m_map_size);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+
+bool ShmRingReader::open(std::string filename) {
+    m_fd = ::open(filename.c_str(), O_RDWR);
+    struct stat file_stat;
+    if (m_fd < 0 || fstat(m_fd, &file_stat) != 0) {
+        std::cerr << "Error: could not open " << filename << "\n";
+        return false;
+    }
+    m_map_size = size_t(file_stat.st_size);
+    if (m_map_size > SHM_RING_HEADER_SIZE) {
+        void * map = mmap(NULL, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (map != MAP_FAILED)
+            m_map = (char *)map;
+    }
+    if (m_map == NULL || memcmp(m_map, "FLRING1\0", 8) != 0) {
+        std::cerr << "Error: " << filename << " is not a Filtlong shared-memory ring buffer\n";
+        return false;
+    }
+
+    memcpy(&m_capacity, m_map + 8, sizeof(uint64_t));
+    if (m_capacity == 0 || m_capacity % 8 != 0 || m_capacity > m_map_size - SHM_RING_HEADER_SIZE) {
+        std::cerr << "Error: " << filename << " has an invalid ring buffer capacity\n";
+        return false;
+    }
+    m_data = m_map + SHM_RING_HEADER_SIZE;
+    m_write_pos = (uint64_t *)(m_map + 16);
+    m_read_pos = (uint64_t *)(m_map + 24);
+    m_closed = (uint64_t *)(m_map + 32);
+    m_position = __atomic_load_n(m_read_pos, __ATOMIC_ACQUIRE);
+    m_record_end = m_position;
+    return true;
+}
+
+
+// Waits for the next record. Returns 1 when a record was read, 0 once the producer has closed the ring and every
+// record has been read, and -1 for a malformed record.
+int ShmRingReader::next(ShmRecord & record) {
+    m_position = m_record_end;
+    while (true) {
+        uint64_t write_pos = __atomic_load_n(m_write_pos, __ATOMIC_ACQUIRE);
+        if (m_position == write_pos) {
+            // The write position is checked again after the closed flag, in case a last record came in between.
+            if (__atomic_load_n(m_closed, __ATOMIC_ACQUIRE) &&
+                    __atomic_load_n(m_write_pos, __ATOMIC_ACQUIRE) == m_position)
+                return 0;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        uint64_t offset = m_position % m_capacity;
+        uint32_t lengths[4];
+        memcpy(lengths, m_data + offset, sizeof(uint32_t));
+
+        // A skip marker means the rest of the data area is unused and the record is at the start. If the previous
+        // record has been released, the skipped space is released too, as the producer may be waiting on it.
+        if (lengths[0] == SHM_RING_SKIP_MARKER) {
+            bool released = (__atomic_load_n(m_read_pos, __ATOMIC_ACQUIRE) == m_position);
+            m_position += m_capacity - offset;
+            m_record_end = m_position;
+            if (released)
+                __atomic_store_n(m_read_pos, m_position, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (m_capacity - offset < sizeof(lengths))
+            return -1;
+        memcpy(lengths, m_data + offset, sizeof(lengths));
+
+        uint64_t record_size = sizeof(lengths) + uint64_t(lengths[0]) + lengths[1] + lengths[2] + lengths[3];
+        if (record_size > m_capacity - offset || lengths[2] > 0x7FFFFFFF ||
+                (lengths[3] != 0 && lengths[3] != lengths[2]))
+            return -1;
+
+        char * p = m_data + offset + sizeof(lengths);
+        record.name.assign(p, lengths[0]);
+        p += lengths[0];
+        record.comment.assign(p, lengths[1]);
+        p += lengths[1];
+        record.seq = p;
+        record.length = int(lengths[2]);
+        p += lengths[2];
+        record.qual = (lengths[3] > 0) ? p : NULL;
+
+        m_record_end = m_position + (record_size + 7) / 8 * 8;
+        return 1;
+    }
+}
+
+
+// Hands the space used by the last record (and any skipped space before it) back to the producer.
+void ShmRingReader::release() {
+    __atomic_store_n(m_read_pos, m_record_end, __ATOMIC_RELEASE);
+}
+
+
+int filter_ring_stream(ShmRingReader & ring, Kmers * kmers, Kmers * exclude_kmers, Arguments * args,
+                       ReadWriter & writer) {
+    std::cerr << "Filtering long reads from shared-memory ring buffer\n";
+    long long read_count = 0, base_count = 0;
+    long long kept_count = 0, kept_bases = 0;
+    ShmRecord record;
+    int result;
+    while ((result = ring.next(record)) > 0) {
+        ++read_count;
+        base_count += record.length;
+        if (record.qual == NULL && kmers->empty()) {
+            std::cerr << "\n\n" << "Error: FASTA input not supported without an external reference" << "\n";
+            return 1;
+        }
+
+        double header_qscore = -1.0;
+        if (args->header_qscore && !record.comment.empty())
+            parse_header_qscore(record.comment.c_str(), header_qscore);
+
+        Read read(record.name, record.seq, record.qual, record.length, kmers, exclude_kmers, args, header_qscore);
+        if (read.m_child_reads.size() == 0) {
+            if (read.m_passed) {
+                writer.write(record.name.c_str(), record.comment.c_str(), record.seq, record.qual, record.length);
+                ++kept_count;
+                kept_bases += record.length;
+            }
+        }
+        else {
+            for (size_t i = 0; i < read.m_child_reads.size(); ++i) {
+                Read * child_read = read.m_child_reads[i];
+                int start = read.m_child_read_ranges[i].first;
+                int length = read.m_child_read_ranges[i].second - start;
+                if (child_read->m_passed && length > 0) {
+                    writer.write(child_read->m_name.c_str(), record.comment.c_str(), record.seq + start,
+                                 (record.qual != NULL) ? record.qual + start : NULL, length);
+                    ++kept_count;
+                    kept_bases += length;
+                }
+            }
+        }
+        ring.release();
+
+        if (read_count % 100 == 0)
+            print_read_score_progress(int(read_count), base_count);
+    }
+    print_read_score_progress(int(read_count), base_count);
+    std::cerr << "\n";
+    if (result < 0) {
+        std::cerr << "Error: malformed record in shared-memory ring buffer after read " << record.name << "\n";
+        return 1;
+    }
+    std::cout.flush();
+    std::cerr << "  kept " << int_to_string(kept_count) << " reads (" << int_to_string(kept_bases) << " bp)\n\n";
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Copyright 2017 Ryan Wick
+
+// This file is part of Filtlong
+
+// Filtlong is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+// version.
+
+// Filtlong is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+// warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+
+// You should have received a copy of the GNU General Public License along with Filtlong.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+
+#include <string>
+#include <stdint.h>
+
+#include "arguments.h"
+#include "kmers.h"
+#include "read_writer.h"
+
+
+// Shared-memory ring buffer protocol (version 1), used to stream reads from a co-located producer (e.g. a basecaller)
+// without files or pipes. The ring is a file which both processes mmap, e.g. in /dev/shm or a memfd opened through
+// /proc/<pid>/fd/<n>. It starts with a 64-byte header of little-endian integers:
+//    0  char[8]  magic "FLRING1\0" (written last by the producer, once the rest of the header is set)
+//    8  uint64   capacity: size in bytes of the data area (a multiple of 8), which starts at byte 64
+//   16  uint64   write position: total bytes the producer has published (only the producer writes this)
+//   24  uint64   read position: total bytes the consumer has released (only the consumer writes this)
+//   32  uint64   closed: the producer sets this to 1 after publishing its last record
+// Positions only increase and map to the data area at (position % capacity).
+//
+// Each record is a 16-byte header (uint32 name, comment, sequence and quality lengths) followed by the name, comment,
+// sequence and qualities, padded to a multiple of 8 bytes. The quality length is either 0 (no qualities) or the
+// sequence length. A record never wraps around the end of the data area: if it doesn't fit, the producer writes a name
+// length of 0xFFFFFFFF as a skip marker, publishes it by advancing the write position past the end of the data area,
+// and starts the record at offset 0. The producer writes a record's bytes before advancing the write position, and the
+// consumer advances the read position once it's finished with a record (or has passed a skip marker), after which the
+// producer may reuse that space. scripts/shm_ring_producer.py is a reference producer.
+#define SHM_RING_HEADER_SIZE 64
+#define SHM_RING_SKIP_MARKER 0xFFFFFFFF
+
+
+// A record in the ring. The sequence and qualities point straight into the shared memory, so they're only valid until
+// the record is released.
+struct ShmRecord
+{
+    std::string name;
+    std::string comment;
+    char * seq;
+    char * qual;
+    int length;
+};
+
+
+class ShmRingReader
+{
+public:
+    ShmRingReader();
+    ~ShmRingReader();
+
+    bool open(std::string filename);
+    int next(ShmRecord & record);
+    void release();
+
+private:
+    int m_fd;
+    size_t m_map_size;
+    char * m_map;
+    char * m_data;
+    uint64_t m_capacity;
+    uint64_t * m_write_pos;
+    uint64_t * m_read_pos;
+    uint64_t * m_closed;
+
+    uint64_t m_position;
+    uint64_t m_record_end;
+};
+
+
+// Scores each read from the ring as it arrives and writes the ones which pass (or their passing trimmed/split parts)
+// straight away. Only per-read thresholds apply, since nothing is known about the reads still to come.
+int filter_ring_stream(ShmRingReader & ring, Kmers * kmers, Kmers * exclude_kmers, Arguments * args,
+                       ReadWriter & writer);
+
+
+#endif // SHM_RING_H
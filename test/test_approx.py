@@ -0,0 +1,91 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import random
+import re
+import shutil
+import subprocess
+import tempfile
+
+
+class TestApprox(unittest.TestCase):
+    """
+    Mean qualities estimated with --approx_length should be within the reported error bound of the
+    exact mean qualities.
+    """
+    def setUp(self):
+        self.binary = os.path.join(os.path.dirname(os.path.dirname(__file__)), 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        self.input = os.path.join(self.temp_dir, 'reads.fastq')
+        rng = random.Random(0)
+        with open(self.input, 'wt') as f:
+            for i in range(10):
+                length = rng.randint(5000, 30000)
+                seq = ''.join(rng.choice('ACGT') for _ in range(length))
+                qual = [chr(33 + rng.randint(2, 30)) for _ in range(length)]
+                low_start = rng.randint(0, length - 1000)  # a low-quality stretch for the window quality
+                qual[low_start:low_start + 1000] = [chr(33 + rng.randint(0, 5)) for _ in range(1000)]
+                f.write('@read_' + str(i) + '\n' + seq + '\n+\n' + ''.join(qual) + '\n')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def get_read_info(self, options):
+        p = subprocess.run([self.binary, '--verbose', '--min_length', '1'] + options + [self.input],
+                           stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        console_out = p.stderr.decode()
+        names = re.findall(r'^(read_\d+)$', console_out, re.MULTILINE)
+        mean_qualities = [float(x) for x in re.findall(r'mean quality = *([\d.]+)', console_out)]
+        window_qualities = [float(x) for x in re.findall(r'window quality = *([\d.]+)', console_out)]
+        errors = [float(x) for x in re.findall(r'^mean quality error = *([\d.]+)', console_out, re.MULTILINE)]
+        window_errors = [float(x) for x in re.findall(r'window quality error = *([\d.]+)', console_out)]
+        return names, mean_qualities, window_qualities, errors, window_errors
+
+    def test_approx_within_error(self):
+        names, exact_mean, exact_window, exact_errors, _ = self.get_read_info([])
+        approx_names, approx_mean, approx_window, errors, window_errors = \
+            self.get_read_info(['--approx_length', '1000'])
+        self.assertEqual(len(names), 10)
+        self.assertEqual(names, approx_names)
+        self.assertEqual(len(exact_errors), 0)
+        self.assertEqual(len(errors), 10)
+        for i in range(10):
+            self.assertTrue(errors[i] > 0.0)
+            self.assertTrue(abs(approx_mean[i] - exact_mean[i]) <= errors[i] + 0.01)
+
+            # The lowest windows are recomputed exactly, so the estimate can't be below the true minimum.
+            self.assertTrue(approx_window[i] >= exact_window[i])
+            self.assertTrue(approx_window[i] - window_errors[i] <= exact_window[i] + 0.01)
+            self.assertTrue(approx_window[i] < approx_mean[i])
+
+    def test_approx_window_threshold(self):
+        """
+        With a --min_window_q threshold in the middle of the reads' window qualities, windows near it are
+        recomputed exactly, so the same reads pass as with exact scoring.
+        """
+        _, _, exact_window, _, _ = self.get_read_info([])
+        threshold = sorted(exact_window)[5]
+        for offset in [-0.01, 0.0, 0.01]:
+            options = ['--min_window_q', str(threshold + offset)]
+            exact = subprocess.run([self.binary] + options + [self.input], stdout=subprocess.PIPE,
+                                   stderr=subprocess.PIPE).stdout
+            approx = subprocess.run([self.binary, '--approx_length', '1000'] + options + [self.input],
+                                    stdout=subprocess.PIPE, stderr=subprocess.PIPE).stdout
+            self.assertEqual(exact, approx)
+            self.assertTrue(len(exact) > 0)
@@ -0,0 +1,84 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import shutil
+import subprocess
+import tempfile
+
+
+class TestCoverageCache(unittest.TestCase):
+    """
+    Scoring reads from a coverage cache (--load_coverage) should give the same output as scoring them
+    against the reference directly.
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.assembly = os.path.join(test_dir, 'test_reference.fasta')
+        self.temp_dir = tempfile.mkdtemp()
+        self.cache = os.path.join(self.temp_dir, 'coverage.txt')
+        self.fastq = {'split': os.path.join(test_dir, 'test_split.fastq'),
+                      'trim': os.path.join(test_dir, 'test_trim.fastq')}
+        self.fasta = {}
+        for name, fastq in self.fastq.items():
+            self.fasta[name] = os.path.join(self.temp_dir, name + '.fasta')
+            with open(fastq, 'rt') as fastq_file, open(self.fasta[name], 'wt') as fasta_file:
+                lines = [line.strip() for line in fastq_file if line.strip()]
+                for i in range(0, len(lines), 4):
+                    fasta_file.write('>' + lines[i][1:] + '\n' + lines[i + 1] + '\n')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def run_filtlong(self, options):
+        p = subprocess.run([self.binary] + options, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertEqual(p.returncode, 0)
+        return p.stdout
+
+    def check_cached_matches_direct(self, input_reads, options):
+        direct = self.run_filtlong(['-a', self.assembly] + options + [input_reads])
+        saved = self.run_filtlong(['-a', self.assembly, '--save_coverage', self.cache] + options + [input_reads])
+        cached = self.run_filtlong(['--load_coverage', self.cache] + options + [input_reads])
+        self.assertTrue(len(direct) > 0)
+        self.assertEqual(direct, saved)
+        self.assertEqual(direct, cached)
+        return cached
+
+    def test_coverage_cache_split_fastq(self):
+        cached = self.check_cached_matches_direct(self.fastq['split'], ['--split', '50'])
+        self.assertTrue(cached.startswith(b'@'))
+
+    def test_coverage_cache_trim_fastq(self):
+        self.check_cached_matches_direct(self.fastq['trim'], ['--trim', '--min_length', '1'])
+
+    def test_coverage_cache_split_fasta(self):
+        cached = self.check_cached_matches_direct(self.fasta['split'], ['--split', '50'])
+        self.assertTrue(cached.startswith(b'>'))
+
+    def test_coverage_cache_trim_fasta(self):
+        self.check_cached_matches_direct(self.fasta['trim'], ['--trim', '--min_length', '1'])
+
+    def test_coverage_cache_fasta_shards(self):
+        self.run_filtlong(['-a', self.assembly, '--save_coverage', self.cache, '--split', '50',
+                           self.fasta['split']])
+        prefix = os.path.join(self.temp_dir, 'shard')
+        self.run_filtlong(['--load_coverage', self.cache, '--split', '50', '--shard_output', prefix,
+                           '--shards', '2', self.fasta['split']])
+        self.assertTrue(os.path.isfile(prefix + '_1.fasta.gz'))
+        self.assertFalse(os.path.isfile(prefix + '_1.fastq.gz'))
@@ -163,6 +163,160 @@ class TestErrorMessages(unittest.TestCase):
         self.assertTrue('Error: the value for --window_size must be a positive integer' in console_out)
         self.assertEqual(return_code, 1)
 
+    def test_header_qscore_with_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --header_qscore --window_q_weight 0 '
+                                                    '--target_bases 1000 INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: --header_qscore cannot be used with an assembly or read reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_header_qscore_with_window_weight(self):
+        console_out, return_code = self.run_command('filtlong --header_qscore --target_bases 1000 '
+                                                    'INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: --header_qscore requires --window_q_weight 0' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_reference_report_one_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --reference_report OUTPUT.tsv '
+                                                    '--target_bases 1000 INPUT')
+        self.assertTrue('Error: --reference_report requires more than one reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_score_reference_one_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --score_reference ASSEMBLY '
+                                                    '--target_bases 1000 INPUT')
+        self.assertTrue('Error: --score_reference requires more than one reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_score_reference_not_a_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY -1 ILLUMINA_1 --score_reference FASTA '
+                                                    '--target_bases 1000 INPUT')
+        self.assertTrue('Error: --score_reference must be one of the -a assemblies or illumina_reads'
+                        in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_save_coverage_without_reference(self):
+        console_out, return_code = self.run_command('filtlong --save_coverage OUTPUT.txt --target_bases 1000 INPUT')
+        self.assertTrue('Error: assembly or read reference is required to use --save_coverage' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_load_coverage_with_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --load_coverage ASSEMBLY --trim INPUT')
+        self.assertTrue('Error: --load_coverage cannot be used with an assembly or read reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_save_kmer_index_without_illumina(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --save_kmer_index OUTPUT.idx '
+                                                    '--target_bases 1000 INPUT')
+        self.assertTrue('Error: Illumina reads or --load_kmer_index are required to use --save_kmer_index'
+                        in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_load_kmer_index_bad_file(self):
+        console_out, return_code = self.run_command('filtlong --load_kmer_index ASSEMBLY --target_bases 1000 INPUT')
+        self.assertTrue('is not a Filtlong k-mer index' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_reference_check_abort(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --reference_check 0.99 '
+                                                    '--reference_check_abort --target_bases 1000 INPUT')
+        self.assertTrue('of 16-mers in the first input reads are in the reference - is it the right one?'
+                        in console_out)
+        self.assertTrue('Error:' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_reference_check_empty_reference(self):
+        """
+        The Illumina reads are all Q17, so --illumina_min_q 20 leaves no 16-mers in the reference.
+        """
+        console_out, return_code = self.run_command('filtlong -1 ILLUMINA_1 --illumina_min_q 20 --split 50 INPUT '
+                                                    '> /dev/null')
+        self.assertTrue('Warning: no 16-mers were taken from the reference' in console_out)
+        self.assertEqual(return_code, 0)
+
+    def test_reference_check_empty_reference_abort(self):
+        console_out, return_code = self.run_command('filtlong -1 ILLUMINA_1 --illumina_min_q 20 '
+                                                    '--reference_check_abort --split 50 INPUT')
+        self.assertTrue('Error: no 16-mers were taken from the reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_reference_check_too_high(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --reference_check 2 '
+                                                    '--target_bases 1000 INPUT')
+        self.assertTrue('Error: the value for --reference_check must be between 0 and 1' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_shards_without_shard_output(self):
+        console_out, return_code = self.run_command('filtlong --shards 2 --target_bases 1000 INPUT')
+        self.assertTrue('Error: --shards, --shard_by_bases and --shard_max_bases require --shard_output'
+                        in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_shm_input_with_target_bases(self):
+        console_out, return_code = self.run_command('filtlong --shm_input --target_bases 1000 INPUT')
+        self.assertTrue('Error: --shm_input only supports per-read thresholds' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_use_index_with_shm_input(self):
+        console_out, return_code = self.run_command('filtlong --use_index --shm_input --min_length 1000 INPUT')
+        self.assertTrue('Error: --use_index cannot be used with --shm_input' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_use_index_without_index(self):
+        console_out, return_code = self.run_command('filtlong --use_index --min_length 1000 INPUT')
+        self.assertTrue('.fai (make it with samtools faidx or fqidx)' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_max_depth_too_high(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --max_depth 65536 INPUT')
+        self.assertTrue('Error: the value for --max_depth cannot be more than 65535' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_max_depth_without_assembly(self):
+        console_out, return_code = self.run_command('filtlong -1 ILLUMINA_1 --max_depth 10 INPUT')
+        self.assertTrue('Error: an assembly reference is required to use --max_depth' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_exclude_fraction_too_high(self):
+        console_out, return_code = self.run_command('filtlong --exclude_assembly ASSEMBLY --exclude_fraction 1 '
+                                                    'INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: the value for --exclude_fraction must be at least 0 and less than 1' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_illumina_min_q_without_illumina_reads(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --illumina_min_q 20 --target_bases 1000 '
+                                                    'INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: Illumina reads are required to use --illumina_min_q' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_minimizer_window_without_reference(self):
+        console_out, return_code = self.run_command('filtlong --minimizer_window 10 --target_bases 1000 '
+                                                    'INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: assembly or read reference is required to use --minimizer_window' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_approx_stride_too_low(self):
+        console_out, return_code = self.run_command('filtlong --approx_length 1000 --approx_stride 0 '
+                                                    '--target_bases 1000 INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: the value for --approx_stride must be a positive integer' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_approx_length_with_reference(self):
+        console_out, return_code = self.run_command('filtlong -a ASSEMBLY --approx_length 1000 '
+                                                    '--target_bases 1000 INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: --approx_length cannot be used with an assembly or read reference' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_qual_bins_not_increasing(self):
+        console_out, return_code = self.run_command('filtlong --qual_bins 20,10 --target_bases 1000 '
+                                                    'INPUT > OUTPUT.fastq')
+        self.assertTrue('Error: --qual_bins values must be in increasing order' in console_out)
+        self.assertEqual(return_code, 1)
+
+    def test_apply_ids_with_write_ids(self):
+        console_out, return_code = self.run_command('filtlong --apply_ids ASSEMBLY --write_ids OUTPUT.txt INPUT')
+        self.assertTrue('Error: --apply_ids and --write_ids cannot be used together' in console_out)
+        self.assertEqual(return_code, 1)
+
     def test_fasta_input(self):
         console_out, return_code = self.run_command('filtlong --target_bases 1000 FASTA > OUTPUT.fastq')
         self.assertTrue('Error: FASTA input not supported without an external reference' in console_out)
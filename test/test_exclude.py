@@ -0,0 +1,96 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+import unittest
+import os
+import subprocess
+
+
+def load_fastq(filename):
+    reads = []
+    with open(filename, 'rb') as fastq:
+        for line in fastq:
+            stripped_line = line.strip()
+            if len(stripped_line) == 0:
+                continue
+            if not stripped_line.startswith(b'@'):
+                continue
+            name = stripped_line[1:].split()[0]
+            sequence = next(fastq).strip()
+            _ = next(fastq)
+            qualities = next(fastq).strip()
+            reads.append((name, sequence, qualities))
+    return reads
+
+
+class TestExclude(unittest.TestCase):
+
+    def run_command(self, command):
+        binary_path = os.path.join(os.path.dirname(os.path.dirname(__file__)), 'bin', 'filtlong')
+        input_path = os.path.join(os.path.dirname(__file__), 'test_sort.fastq')
+        unrelated_input_path = os.path.join(os.path.dirname(__file__), 'test_trim.fastq')
+        assembly_reference = os.path.join(os.path.dirname(__file__), 'test_reference.fasta')
+        unrelated_assembly = os.path.join(os.path.dirname(__file__), 'test_sort.fasta')
+
+        command = command.replace('filtlong', binary_path)
+        command = command.replace('UNRELATED_INPUT', unrelated_input_path)
+        command = command.replace('INPUT', input_path)
+        command = command.replace('UNRELATED_ASSEMBLY', unrelated_assembly)
+        command = command.replace('ASSEMBLY', assembly_reference)
+
+        output_name = 'TEMP_' + str(os.getpid())
+        command = command.replace('OUTPUT', output_name)
+        try:
+            self.output_file = [x for x in command.split() if output_name in x][0]
+        except IndexError:
+            self.output_file = ''
+        p = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
+        _, err = p.communicate()
+        return err.decode()
+
+    def tearDown(self):
+        if os.path.isfile(self.output_file):
+            os.remove(self.output_file)
+
+    def test_exclude_all(self):
+        """
+        All three reads come from the reference, so they should all be excluded.
+        """
+        console_out = self.run_command('filtlong --exclude_assembly ASSEMBLY INPUT > OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        self.assertEqual(len(output_reads), 0)
+        self.assertTrue('excluded: 3 reads' in console_out)
+
+    def test_exclude_high_fraction(self):
+        """
+        The reads have 100%, 67% and 87% of their 16-mers in the reference, so a 0.9 threshold should only
+        exclude the first.
+        """
+        console_out = self.run_command('filtlong --exclude_assembly ASSEMBLY --exclude_fraction 0.9 '
+                                       'INPUT > OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        self.assertEqual(len(output_reads), 2)
+        self.assertTrue('excluded: 1 reads' in console_out)
+
+    def test_exclude_none(self):
+        """
+        The trim test reads share nothing with the sort test reads, so none should be excluded.
+        """
+        console_out = self.run_command('filtlong --exclude_assembly UNRELATED_ASSEMBLY UNRELATED_INPUT '
+                                       '> OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        self.assertEqual(len(output_reads), 4)
+        self.assertTrue('excluded: 0 reads' in console_out)
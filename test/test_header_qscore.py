@@ -0,0 +1,70 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+
+
+class TestHeaderQscore(unittest.TestCase):
+    """
+    These reads all have the same length and per-base qscores (Q20), but their headers give different
+    mean qscores. read_d has no header qscore, so it should fall back to its per-base qscores.
+    """
+    def setUp(self):
+        self.binary = os.path.join(os.path.dirname(os.path.dirname(__file__)), 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        self.input = os.path.join(self.temp_dir, 'reads.fastq')
+        rng = random.Random(0)
+        headers = [('read_a', 'qs:f:5'), ('read_b', 'ch=1 mean_qscore_template=15'), ('read_c', 'qs:i:25'),
+                   ('read_d', 'ch=2')]
+        with open(self.input, 'wt') as f:
+            for name, comment in headers:
+                seq = ''.join(rng.choice('ACGT') for _ in range(1000))
+                f.write('@' + name + ' ' + comment + '\n' + seq + '\n+\n' + '5' * 1000 + '\n')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def run_filtlong(self, options):
+        p = subprocess.run([self.binary] + options + [self.input], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        read_names = [line[1:].split()[0].decode() for line in p.stdout.splitlines()[::4]]
+        return read_names, p.stderr.decode()
+
+    def test_per_base_qscores(self):
+        read_names, _ = self.run_filtlong(['--min_mean_q', '90'])
+        self.assertEqual(read_names, ['read_a', 'read_b', 'read_c', 'read_d'])
+
+    def test_header_qscore_min_mean_q(self):
+        """
+        qs:f:5 is about 68% and mean_qscore_template=15 is about 97%, so only read_a fails 90.
+        """
+        read_names, console_out = self.run_filtlong(['--header_qscore', '--window_q_weight', '0',
+                                                     '--min_mean_q', '90'])
+        self.assertEqual(read_names, ['read_b', 'read_c', 'read_d'])
+        self.assertTrue('from header qscores: 3 reads, from per-base qscores: 1 reads' in console_out)
+
+    def test_header_qscore_order(self):
+        """
+        The best two reads are read_c (Q25 from its header) and read_d (Q20 from its per-base qscores).
+        """
+        read_names, _ = self.run_filtlong(['--header_qscore', '--window_q_weight', '0',
+                                           '--target_bases', '2000'])
+        self.assertEqual(read_names, ['read_c', 'read_d'])
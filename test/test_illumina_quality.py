@@ -0,0 +1,81 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+
+
+class TestIlluminaQuality(unittest.TestCase):
+    """
+    Five copies of one 100 bp Illumina read (so every 16-mer is solid). Without any quality settings, that's 85
+    positions, giving 170 16-mers (both strands).
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.input = os.path.join(test_dir, 'test_sort.fastq')
+        self.temp_dir = tempfile.mkdtemp()
+        rng = random.Random(0)
+        self.seq = ''.join(rng.choice('ACGT') for _ in range(100))
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def hash_reads(self, qualities, options):
+        illumina = os.path.join(self.temp_dir, 'illumina.fastq')
+        with open(illumina, 'wt') as f:
+            for i in range(5):
+                f.write('@read_' + str(i) + '\n' + self.seq + '\n+\n' + qualities + '\n')
+        p = subprocess.run([self.binary, '-1', illumina, '--min_length', '1'] + options + [self.input],
+                           stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        return p.stderr.decode()
+
+    def test_no_quality_settings(self):
+        console_out = self.hash_reads('I' * 80 + '#' * 20, [])
+        self.assertTrue('(500 bp)' in console_out)
+        self.assertTrue('5 reads, 170 16-mers' in console_out)
+
+    def test_trim_q(self):
+        """
+        The last 20 bases are Q2, so they're trimmed off, leaving 65 positions (130 16-mers).
+        """
+        console_out = self.hash_reads('I' * 80 + '#' * 20, ['--illumina_trim_q', '10'])
+        self.assertTrue('100 bp trimmed from low-quality read tails' in console_out)
+        self.assertTrue('(400 bp)' in console_out)
+        self.assertTrue('5 reads, 130 16-mers' in console_out)
+
+    def test_min_q(self):
+        """
+        One Q2 base in the middle is in 16 of each read's 16-mer positions, leaving 69 positions (138 16-mers).
+        """
+        console_out = self.hash_reads('I' * 50 + '#' + 'I' * 49, ['--illumina_min_q', '20'])
+        self.assertTrue('80 low-quality 16-mers skipped' in console_out)
+        self.assertTrue('5 reads, 138 16-mers' in console_out)
+
+    def test_min_q_above_trimmed_tail(self):
+        """
+        With both set, the tail is trimmed first, so its low-quality bases don't count as skipped 16-mers.
+        """
+        console_out = self.hash_reads('I' * 50 + '#' + 'I' * 29 + '#' * 20,
+                                      ['--illumina_trim_q', '10', '--illumina_min_q', '20'])
+        self.assertTrue('100 bp trimmed from low-quality read tails' in console_out)
+        self.assertTrue('80 low-quality 16-mers skipped' in console_out)
+        self.assertTrue('5 reads, 98 16-mers' in console_out)
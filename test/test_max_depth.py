@@ -0,0 +1,82 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+
+class TestMaxDepthRepeats(unittest.TestCase):
+    """
+    The reference has a 3 kbp repeat, with unique sequence either side of both copies. Reads entirely in the repeat
+    could be from either copy, so --max_depth should let them fill both copies before it fails any.
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        random.seed(0)
+        self.unique = [self.random_seq(3000) for _ in range(3)]
+        self.repeat = self.random_seq(3000)
+        self.assembly = os.path.join(self.temp_dir, 'assembly.fasta')
+        with open(self.assembly, 'wt') as f:
+            f.write('>contig\n' + self.unique[0] + self.repeat + self.unique[1] + self.repeat + self.unique[2] +
+                    '\n')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    @staticmethod
+    def random_seq(length):
+        return ''.join(random.choice('ACGT') for _ in range(length))
+
+    def run_max_depth(self, reads, options):
+        reads_file = os.path.join(self.temp_dir, 'reads.fastq')
+        with open(reads_file, 'wt') as f:
+            for name, seq in reads:
+                f.write('@' + name + '\n' + seq + '\n+\n' + 'I' * len(seq) + '\n')
+        p = subprocess.run([self.binary, '-a', self.assembly, '--min_length', '1'] + options + [reads_file],
+                           stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertEqual(p.returncode, 0)
+        return [line[1:] for line in p.stdout.decode().splitlines()[0::4]]
+
+    def test_repeat_reads_fill_both_copies(self):
+        reads = [('repeat_' + str(i + 1), self.repeat[500:2500]) for i in range(3)]
+        self.assertEqual(self.run_max_depth(reads, ['--max_depth', '1']), ['repeat_1', 'repeat_2'])
+
+    def test_repeat_reads_fill_both_copies_minimizers(self):
+        reads = [('repeat_' + str(i + 1), self.repeat[500:2500]) for i in range(3)]
+        self.assertEqual(self.run_max_depth(reads, ['--max_depth', '1', '--minimizer_window', '5']),
+                         ['repeat_1', 'repeat_2'])
+
+    def test_anchored_read_fills_its_own_copy(self):
+        """
+        The first (longest, so best) read spans the start of the first copy, so only the second copy still needs a
+        read entirely in the repeat.
+        """
+        reads = [('anchored', self.unique[0][1000:] + self.repeat[:2000])]
+        reads += [('repeat_' + str(i + 1), self.repeat[:2000]) for i in range(2)]
+        self.assertEqual(self.run_max_depth(reads, ['--max_depth', '1']), ['anchored', 'repeat_1'])
+
+    def test_repeat_reads_max_depth_2(self):
+        reads = [('repeat_' + str(i + 1), self.repeat[500:2500]) for i in range(5)]
+        self.assertEqual(self.run_max_depth(reads, ['--max_depth', '2']),
+                         ['repeat_1', 'repeat_2', 'repeat_3', 'repeat_4'])
@@ -0,0 +1,68 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import shutil
+import subprocess
+import tempfile
+
+
+class TestReadIds(unittest.TestCase):
+    """
+    Applying a read ID list made with --write_ids should output exactly the reads (and trimmed/split
+    ranges) of the run which wrote it.
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.assembly = os.path.join(test_dir, 'test_reference.fasta')
+        self.split_input = os.path.join(test_dir, 'test_split.fastq')
+        self.trim_input = os.path.join(test_dir, 'test_trim.fastq')
+        self.temp_dir = tempfile.mkdtemp()
+        self.ids = os.path.join(self.temp_dir, 'ids.txt')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def run_filtlong(self, options):
+        p = subprocess.run([self.binary] + options, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertEqual(p.returncode, 0)
+        return p.stdout
+
+    def check_round_trip(self, input_reads, options):
+        written = self.run_filtlong(['-a', self.assembly, '--write_ids', self.ids] + options + [input_reads])
+        applied = self.run_filtlong(['--apply_ids', self.ids, input_reads])
+        self.assertTrue(len(written) > 0)
+        self.assertEqual(written, applied)
+        with open(self.ids, 'rt') as f:
+            return [line.rstrip('\n').split('\t') for line in f]
+
+    def test_read_ids_split(self):
+        ids = self.check_round_trip(self.split_input, ['--split', '50'])
+        self.assertEqual(ids[0], ['test_split_1'])
+        self.assertEqual(ids[1], ['test_split_2', '0', '1000'])
+        self.assertEqual(len(ids), 7)
+
+    def test_read_ids_trim(self):
+        ids = self.check_round_trip(self.trim_input, ['--trim', '--min_length', '1'])
+        self.assertEqual(ids[1], ['test_trim_2', '20', '701'])
+        self.assertEqual(len(ids), 4)
+
+    def test_read_ids_target_bases(self):
+        ids = self.check_round_trip(self.split_input, ['--split', '50', '--target_bases', '5000'])
+        self.assertTrue(len(ids) < 7)
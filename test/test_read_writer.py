@@ -0,0 +1,69 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+
+import gzip
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+
+class TestReadWriter(unittest.TestCase):
+    """
+    Header comments should be written for the reads which have them and for no others: kseq keeps the
+    previous read's comment text around when a read has none, so it mustn't leak into the next header.
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        self.reads = os.path.join(self.temp_dir, 'reads.fastq')
+        random.seed(0)
+        with open(self.reads, 'wt') as f:
+            for header in ['r1 ch=5 foo', 'r2', 'r3 bar', 'r4']:
+                seq = ''.join(random.choice('ACGT') for _ in range(1000))
+                f.write('@' + header + '\n' + seq + '\n+\n' + 'I' * 1000 + '\n')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def run_filtlong(self, options):
+        p = subprocess.run([self.binary] + options, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertEqual(p.returncode, 0)
+        return p.stdout.decode()
+
+    def check_headers(self, fastq):
+        headers = fastq.splitlines()[0::4]
+        self.assertEqual(headers, ['@r1 ch=5 foo', '@r2', '@r3 bar', '@r4'])
+
+    def test_comments_stdout(self):
+        self.check_headers(self.run_filtlong(['--min_length', '1', self.reads]))
+
+    def test_comments_shard_output(self):
+        prefix = os.path.join(self.temp_dir, 'shard')
+        self.run_filtlong(['--min_length', '1', '--shard_output', prefix, '--shards', '1', self.reads])
+        with gzip.open(prefix + '_1.fastq.gz', 'rt') as f:
+            self.check_headers(f.read())
+
+    def test_comments_apply_ids(self):
+        ids = os.path.join(self.temp_dir, 'ids.txt')
+        with open(ids, 'wt') as f:
+            f.write('r1\nr2\nr3\nr4\n')
+        self.check_headers(self.run_filtlong(['--apply_ids', ids, self.reads]))
@@ -0,0 +1,88 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+
+import gzip
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+
+class TestShards(unittest.TestCase):
+    """
+    Tests for how --shard_output spreads reads over its shard files.
+    """
+    def setUp(self):
+        test_dir = os.path.dirname(__file__)
+        self.binary = os.path.join(os.path.dirname(test_dir), 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        self.prefix = os.path.join(self.temp_dir, 'shard')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def make_reads(self, lengths):
+        random.seed(0)
+        reads = os.path.join(self.temp_dir, 'reads.fastq')
+        with open(reads, 'wt') as f:
+            for i, length in enumerate(lengths):
+                seq = ''.join(random.choice('ACGT') for _ in range(length))
+                f.write('@read_' + str(i + 1) + '\n' + seq + '\n+\n' + 'I' * length + '\n')
+        return reads
+
+    def run_shards(self, lengths, options):
+        reads = self.make_reads(lengths)
+        p = subprocess.run([self.binary, '--min_length', '1', '--shard_output', self.prefix] + options + [reads],
+                           stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertEqual(p.returncode, 0)
+        shards = []
+        while os.path.isfile(self.prefix + '_' + str(len(shards) + 1) + '.fastq.gz'):
+            with gzip.open(self.prefix + '_' + str(len(shards) + 1) + '.fastq.gz', 'rt') as f:
+                lines = f.read().splitlines()
+            shards.append([(lines[i][1:], len(lines[i + 1])) for i in range(0, len(lines), 4)])
+        return shards
+
+    def test_round_robin(self):
+        shards = self.run_shards([8000, 2000, 2000, 2000, 2000], ['--shards', '2'])
+        self.assertEqual([[name for name, _ in shard] for shard in shards],
+                         [['read_1', 'read_3', 'read_5'], ['read_2', 'read_4']])
+
+    def test_shard_by_bases(self):
+        """
+        The first read alone has as many bases as the rest together, so it should get a shard to itself.
+        """
+        shards = self.run_shards([8000, 2000, 2000, 2000, 2000], ['--shards', '2', '--shard_by_bases'])
+        self.assertEqual([[name for name, _ in shard] for shard in shards],
+                         [['read_1'], ['read_2', 'read_3', 'read_4', 'read_5']])
+        self.assertEqual([sum(length for _, length in shard) for shard in shards], [8000, 8000])
+
+    def test_shard_by_bases_three_shards(self):
+        shards = self.run_shards([3000, 1000, 1000, 1000, 2000, 1000], ['--shards', '3', '--shard_by_bases'])
+        self.assertEqual([sum(length for _, length in shard) for shard in shards], [3000, 3000, 3000])
+
+    def test_shard_max_bases(self):
+        """
+        A new shard is started when the next read would take the current one past the limit. A read longer than the
+        limit gets a shard of its own.
+        """
+        shards = self.run_shards([3000, 3000, 3000, 1000, 1000, 6000, 1000], ['--shard_max_bases', '5000'])
+        self.assertEqual(len(shards), 5)
+        self.assertEqual([sum(length for _, length in shard) for shard in shards], [3000, 3000, 5000, 6000, 1000])
+        self.assertEqual([len(shard) for shard in shards], [1, 1, 3, 1, 1])
@@ -0,0 +1,69 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+import unittest
+import os
+import subprocess
+import sys
+import time
+
+
+class TestShmRing(unittest.TestCase):
+    """
+    Reads streamed through a shared-memory ring buffer (by the reference producer script) should give
+    the same output as reading them from the file.
+    """
+    def setUp(self):
+        repo_dir = os.path.dirname(os.path.dirname(__file__))
+        self.binary = os.path.join(repo_dir, 'bin', 'filtlong')
+        self.producer = os.path.join(repo_dir, 'scripts', 'shm_ring_producer.py')
+        self.input = os.path.join(os.path.dirname(__file__), 'test_split.fastq')
+        self.assembly = os.path.join(os.path.dirname(__file__), 'test_reference.fasta')
+        self.ring = 'TEMP_' + str(os.getpid()) + '.ring'
+
+    def tearDown(self):
+        if os.path.isfile(self.ring):
+            os.remove(self.ring)
+
+    def run_both(self, options):
+        expected = subprocess.run([self.binary] + options + [self.input],
+                                  stdout=subprocess.PIPE, stderr=subprocess.PIPE).stdout
+
+        # A small ring makes sure the producer has to wrap around and wait for space.
+        producer = subprocess.Popen([sys.executable, self.producer, '--capacity', '16384', self.ring,
+                                     self.input])
+        while not self.ring_ready():
+            time.sleep(0.01)
+        streamed = subprocess.run([self.binary, '--shm_input'] + options + [self.ring],
+                                  stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=60).stdout
+        producer.wait(timeout=60)
+        return expected, streamed
+
+    def ring_ready(self):
+        if not os.path.isfile(self.ring):
+            return False
+        with open(self.ring, 'rb') as ring:
+            return ring.read(8) == b'FLRING1\0'
+
+    def test_shm_ring_min_length(self):
+        expected, streamed = self.run_both(['--min_length', '2000'])
+        self.assertEqual(expected, streamed)
+        self.assertTrue(len(streamed) > 0)
+
+    def test_shm_ring_split(self):
+        expected, streamed = self.run_both(['-a', self.assembly, '--split', '50'])
+        self.assertEqual(expected, streamed)
+        self.assertTrue(len(streamed) > 0)
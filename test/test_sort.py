@@ -17,6 +17,7 @@ not, see <http://www.gnu.org/licenses/>.
 import unittest
 import os
 import subprocess
+import gzip
 
 
 def load_fastq(filename):
@@ -117,6 +118,69 @@ class TestSort(unittest.TestCase):
         self.assertTrue('target: 100,000 bp' in console_out)
         self.assertTrue('not enough reads to reach target' in console_out)
 
+    def test_sort_high_threshold_1_fasta_output(self):
+        self.run_command('filtlong --fasta_output --target_bases 100000 INPUT > OUTPUT.fasta')
+        output_reads = load_fasta(self.output_file)
+        read_names = [x[0].decode() for x in output_reads]
+        self.assertEqual(read_names, ['test_sort_1', 'test_sort_2', 'test_sort_3'])
+        input_reads = load_fastq(os.path.join(os.path.dirname(__file__), 'test_sort.fastq'))
+        self.assertEqual([x[1] for x in output_reads], [x[1] for x in input_reads])
+
+    def test_sort_high_threshold_1_qual_bins(self):
+        self.run_command('filtlong --qual_bins 5,10,20 --target_bases 100000 INPUT > OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        read_names = [x[0].decode() for x in output_reads]
+        self.assertEqual(read_names, ['test_sort_1', 'test_sort_2', 'test_sort_3'])
+        for read in output_reads:
+            self.assertTrue(set(read[2]) <= {ord('&'), ord('+'), ord('5')})
+
+    def test_sort_selection_curve(self):
+        self.run_command('filtlong --selection_curve OUTPUT.tsv INPUT')
+        with open(self.output_file, 'rt') as curve:
+            rows = [line.rstrip('\n').split('\t') for line in curve]
+        self.assertEqual(rows[0], ['score_threshold', 'reads', 'bases', 'percent_bases', 'mean_quality',
+                                   'n50'])
+        self.assertEqual([int(x[1]) for x in rows[1:]], [1, 2, 3])
+        scores = [float(x[0]) for x in rows[1:]]
+        self.assertEqual(scores, sorted(scores, reverse=True))
+        self.assertEqual(float(rows[-1][3]), 100.0)
+
+    def test_sort_selection_curve_max_depth(self):
+        """
+        Reads dropped by --max_depth can't be kept, so they aren't on the curve.
+        """
+        self.run_command('filtlong -a ASSEMBLY --max_depth 1 --selection_curve OUTPUT.tsv INPUT > /dev/null')
+        with open(self.output_file, 'rt') as curve:
+            rows = [line.rstrip('\n').split('\t') for line in curve]
+        self.assertEqual(len(rows), 2)
+        self.assertEqual(rows[1][1:3], ['1', '5000'])
+
+    def test_sort_high_threshold_1_shards(self):
+        self.run_command('filtlong --shard_output OUTPUT --shards 2 --target_bases 100000 INPUT')
+        shard_files = [self.output_file + '_1.fastq.gz', self.output_file + '_2.fastq.gz']
+        read_names = []
+        for shard_file in shard_files:
+            with gzip.open(shard_file, 'rb') as shard:
+                read_names += [line[1:].split()[0].decode() for i, line in enumerate(shard) if i % 4 == 0]
+            os.remove(shard_file)
+        self.assertEqual(read_names, ['test_sort_1', 'test_sort_3', 'test_sort_2'])
+
+    def test_sort_max_depth_1_assembly_ref(self):
+        """
+        The three reads overlap on the reference, so with a max depth of 1 only the best is kept.
+        """
+        console_out = self.run_command('filtlong -a ASSEMBLY --max_depth 1 INPUT > OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        read_names = [x[0].decode() for x in output_reads]
+        self.assertEqual(read_names, ['test_sort_1'])
+        self.assertTrue('in regions already at depth 1' in console_out)
+
+    def test_sort_max_depth_3_assembly_ref(self):
+        self.run_command('filtlong -a ASSEMBLY --max_depth 3 INPUT > OUTPUT.fastq')
+        output_reads = load_fastq(self.output_file)
+        read_names = [x[0].decode() for x in output_reads]
+        self.assertEqual(read_names, ['test_sort_1', 'test_sort_2', 'test_sort_3'])
+
     def test_sort_high_threshold_1_read_ref_fasta(self):
         console_out = self.run_command('filtlong -1 ILLUMINA_1 -2 ILLUMINA_2 --target_bases 100000 FASTA > OUTPUT.fastq')
         output_reads = load_fasta(self.output_file)
@@ -352,3 +416,35 @@ class TestSort(unittest.TestCase):
         self.assertEqual(read_names, ['test_sort_1'])
         self.assertTrue('target: 1 bp' in console_out)
         self.assertTrue('keeping 5,000 bp' in console_out)
+
+    def test_reference_report_two_assemblies(self):
+        """
+        All three reads come from test_sort.fasta, but test_reference.fasta only matches part of the second and
+        third reads. Each read's hit fraction is reported separately for each reference.
+        """
+        self.run_command('filtlong -a ASSEMBLY -a FASTA --reference_report OUTPUT.tsv --min_length 1 INPUT '
+                         '> /dev/null')
+        with open(self.output_file, 'rt') as report:
+            rows = [line.rstrip('\n').split('\t') for line in report]
+        self.assertEqual(rows[0][:2], ['read_name', 'length'])
+        self.assertTrue(rows[0][2].endswith('test_reference.fasta'))
+        self.assertTrue(rows[0][3].endswith('test_sort.fasta'))
+        self.assertEqual([row[0] for row in rows[1:]], ['test_sort_1', 'test_sort_2', 'test_sort_3'])
+        expected_fractions = [(1.0, 1.0), (0.67, 1.0), (0.87, 1.0)]
+        for row, expected in zip(rows[1:], expected_fractions):
+            self.assertEqual(row[1], '5000')
+            self.assertAlmostEqual(float(row[2]), expected[0], places=2)
+            self.assertAlmostEqual(float(row[3]), expected[1], places=2)
+
+    def test_score_reference(self):
+        """
+        Every read is entirely in test_sort.fasta, so with both references they all pass a window quality filter.
+        Scoring against only test_reference.fasta fails the second read, which that reference only partly matches.
+        """
+        self.run_command('filtlong -a ASSEMBLY -a FASTA --min_window_q 90 INPUT > OUTPUT.fastq')
+        self.assertEqual([x[0].decode() for x in load_fastq(self.output_file)],
+                         ['test_sort_1', 'test_sort_2', 'test_sort_3'])
+        os.remove(self.output_file)
+        self.run_command('filtlong -a ASSEMBLY -a FASTA --score_reference ASSEMBLY --min_window_q 90 INPUT '
+                         '> OUTPUT.fastq')
+        self.assertEqual([x[0].decode() for x in load_fastq(self.output_file)], ['test_sort_1', 'test_sort_3'])
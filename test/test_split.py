@@ -17,6 +17,8 @@ not, see <http://www.gnu.org/licenses/>.
 import unittest
 import os
 import subprocess
+import tempfile
+import shutil
 
 
 def load_fastq(filename):
@@ -221,3 +223,43 @@ class TestSplit(unittest.TestCase):
         self.assertEqual(split_reads[4][0], b'test_split_3_1101-2900')
         self.assertEqual(split_reads[5][0], b'test_split_4_1-1000')
         self.assertEqual(split_reads[6][0], b'test_split_4_1201-2900')
+
+    def test_split_minimizers(self):
+        """
+        With a minimizer index, split points can move by up to a window, but the same pieces should come out.
+        """
+        console_out = self.run_command('filtlong -a ASSEMBLY --minimizer_window 10 --split 25 INPUT > OUTPUT.fastq')
+        self.assertTrue('minimizers (w=10)' in console_out)
+        split_reads = load_fastq(self.output_file)
+        self.assertEqual(len(split_reads), 7)
+        expected_ranges = [(1, 1000), (1051, 2900), (1, 1000), (1101, 2900), (1, 1000), (1201, 2900)]
+        self.assertEqual(split_reads[0][0], b'test_split_1')
+        for read, expected_range in zip(split_reads[1:], expected_ranges):
+            start, end = [int(x) for x in read[0].decode().split('_')[-1].split('-')]
+            self.assertTrue(abs(start - expected_range[0]) <= 10)
+            self.assertTrue(abs(end - expected_range[1]) <= 10)
+            self.assertEqual(len(read[1]), end - start + 1)
+
+    def test_split_kmer_index_round_trip(self):
+        """
+        Saving an index of the first Illumina file and then adding the second file to it should give the
+        same result (and the same index) as hashing both files in one run.
+        """
+        temp_dir = tempfile.mkdtemp()
+        try:
+            index_1 = os.path.join(temp_dir, 'index_1.idx')
+            index_2 = os.path.join(temp_dir, 'index_2.idx')
+            index_both = os.path.join(temp_dir, 'index_both.idx')
+            self.run_command('filtlong -1 ILLUMINA_1 -2 ILLUMINA_2 --save_kmer_index ' + index_both +
+                             ' --split 50 INPUT > OUTPUT.fastq')
+            both_reads = load_fastq(self.output_file)
+            self.run_command('filtlong -1 ILLUMINA_1 --save_kmer_index ' + index_1 + ' --split 50 INPUT > /dev/null')
+            console_out = self.run_command('filtlong --load_kmer_index ' + index_1 + ' -2 ILLUMINA_2 '
+                                           '--save_kmer_index ' + index_2 + ' --split 50 INPUT > OUTPUT.fastq')
+            self.assertTrue('single 16-mers' in console_out)
+            self.assertEqual(load_fastq(self.output_file), both_reads)
+            self.assertTrue(len(both_reads) > 4)
+            with open(index_both, 'rb') as f_both, open(index_2, 'rb') as f_2:
+                self.assertEqual(f_both.read(), f_2.read())
+        finally:
+            shutil.rmtree(temp_dir)
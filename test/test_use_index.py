@@ -0,0 +1,158 @@
+"""
+Copyright 2017 Ryan Wick (rrwick@gmail.com)
+https://github.com/rrwick/Filtlong
+
+This module contains some tests for Filtlong. To run them, execute `python3 -m unittest` from the
+root Filtlong directory.
+
+This file is part of Filtlong. Filtlong is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version. Filtlong is distributed in
+the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+details. You should have received a copy of the GNU General Public License along with Filtlong. If
+not, see <http://www.gnu.org/licenses/>.
+"""
+
+
+import unittest
+import os
+import random
+import shutil
+import struct
+import subprocess
+import tempfile
+import zlib
+
+
+class TestUseIndex(unittest.TestCase):
+    """
+    Reads found with a samtools-style index (for both plain and BGZF-compressed input) should give the
+    same output as reading the whole file, when length alone decides which reads pass.
+    """
+    def setUp(self):
+        repo_dir = os.path.dirname(os.path.dirname(__file__))
+        self.binary = os.path.join(repo_dir, 'bin', 'filtlong')
+        self.temp_dir = tempfile.mkdtemp()
+        self.plain = os.path.join(self.temp_dir, 'reads.fastq')
+        self.bgzf = os.path.join(self.temp_dir, 'reads.fastq.gz')
+        self.make_indexed_reads()
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_dir)
+
+    def make_indexed_reads(self, lengths=None, block_size=4096):
+        rng = random.Random(0)
+        if lengths is None:
+            lengths = [rng.randint(100, 3000) for _ in range(40)]
+        data, fai = b'', ''
+        for i, length in enumerate(lengths):
+            seq = ''.join(rng.choices('ACGT', k=length)).encode()
+            qual = ''.join(chr(33 + q) for q in rng.choices(range(5, 31), k=length)).encode()
+            name = 'read_' + str(i)
+            header = ('@' + name + ' comment\n').encode()
+            seq_offset = len(data) + len(header)
+            data += header + seq + b'\n+\n'
+            qual_offset = len(data)
+            data += qual + b'\n'
+            fai += '\t'.join(str(x) for x in [name, length, seq_offset, length, length + 1, qual_offset]) + '\n'
+        with open(self.plain, 'wb') as f:
+            f.write(data)
+
+        # Small blocks (each its own gzip member, as in BGZF) so reads span blocks and some are skipped.
+        compressed, blocks = b'', []
+        for start in range(0, len(data), block_size):
+            if start > 0:
+                blocks.append((len(compressed), start))
+            compressor = zlib.compressobj(6, zlib.DEFLATED, 31)
+            compressed += compressor.compress(data[start:start + block_size]) + compressor.flush()
+        with open(self.bgzf, 'wb') as f:
+            f.write(compressed)
+        with open(self.bgzf + '.gzi', 'wb') as f:
+            f.write(struct.pack('<Q', len(blocks)))
+            for block in blocks:
+                f.write(struct.pack('<QQ', *block))
+        for filename in [self.plain, self.bgzf]:
+            with open(filename + '.fai', 'wt') as f:
+                f.write(fai)
+
+    def run_filtlong(self, options):
+        return subprocess.run([self.binary] + options, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    def check_matches_full_read(self, options):
+        expected = self.run_filtlong(options + [self.plain]).stdout
+        self.assertTrue(len(expected) > 0)
+        for filename in [self.plain, self.bgzf]:
+            indexed = self.run_filtlong(['--use_index'] + options + [filename])
+            self.assertEqual(indexed.returncode, 0)
+            self.assertEqual(expected, indexed.stdout)
+        return indexed.stderr.decode()
+
+    def test_use_index_min_length(self):
+        self.check_matches_full_read(['--min_length', '2000'])
+
+    def test_use_index_target_bases(self):
+        console_out = self.check_matches_full_read(['--target_bases', '10000', '--mean_q_weight', '0',
+                                                    '--window_q_weight', '0'])
+        self.assertTrue('40 reads' in console_out)
+
+    def test_use_index_keep_percent(self):
+        self.check_matches_full_read(['--keep_percent', '25', '--min_length', '500', '--mean_q_weight', '0',
+                                      '--window_q_weight', '0'])
+
+    def test_use_index_selection_curve(self):
+        """
+        The selection curve covers every read which can pass, so the target can't be used to skip reads.
+        """
+        curve = os.path.join(self.temp_dir, 'curve.tsv')
+        result = self.run_filtlong(['--use_index', '--target_bases', '10000', '--mean_q_weight', '0',
+                                    '--window_q_weight', '0', '--selection_curve', curve, self.bgzf])
+        self.assertEqual(result.returncode, 0)
+        self.assertTrue('scoring 40 reads' in result.stderr.decode())
+        with open(curve, 'rt') as f:
+            last_row = f.read().splitlines()[-1].split('\t')
+        self.assertEqual(last_row[1], '40')
+        self.assertEqual(float(last_row[3]), 100.0)
+
+    def test_use_index_mismatch(self):
+        with open(self.plain + '.fai', 'rt') as f:
+            fai = f.read()
+        with open(self.plain + '.fai', 'wt') as f:
+            f.write(fai.replace('read_0\t', 'read_x\t'))
+        result = self.run_filtlong(['--use_index', '--min_length', '100', self.plain])
+        self.assertEqual(result.returncode, 1)
+        self.assertTrue('does not match the input reads (expected read_x with ' in result.stderr.decode())
+        self.assertTrue('found read_0 with ' in result.stderr.decode())
+
+    def test_use_index_truncated_input(self):
+        """
+        If the reads file has fewer reads than its index lists, that's an error (not an early, successful finish).
+        """
+        lengths = [random.Random(1).randint(100, 3000) for _ in range(40)]
+        self.make_indexed_reads(lengths)
+        with open(self.plain + '.fai', 'rt') as f:
+            fai = f.read()
+        self.make_indexed_reads(lengths[:30])
+        for filename in [self.plain, self.bgzf]:
+            with open(filename + '.fai', 'wt') as f:
+                f.write(fai)
+            result = self.run_filtlong(['--use_index', '--min_length', '100', filename])
+            self.assertEqual(result.returncode, 1)
+            self.assertTrue('ended before read read_30' in result.stderr.decode())
+
+    def test_use_index_missing_gzi(self):
+        os.remove(self.bgzf + '.gzi')
+        result = self.run_filtlong(['--use_index', '--min_length', '100', self.bgzf])
+        self.assertEqual(result.returncode, 1)
+        self.assertTrue('compressed input must be BGZF' in result.stderr.decode())
+
+    def test_use_index_distant_reads(self):
+        """
+        In a larger file where only the last two reads pass, the BGZF stream is reopened near the end when scoring.
+        The output pass starts a fresh stream, so it mustn't reuse the scoring pass's stream position.
+        """
+        lengths = [300] * 4000 + [3000, 3000]
+        self.make_indexed_reads(lengths, 65536)
+        self.assertTrue(os.path.getsize(self.plain) > 2000000)
+        console_out = self.check_matches_full_read(['--min_length', '2500'])
+        self.assertTrue('scoring 2 reads' in console_out)